@@ -74,11 +74,11 @@ ArtdClassId::equals(const ArtdClassId &b) const {
 	}
 	return(true);
 }
+static RcStringLiteral nullString("[null]");
+
 RcString
 ArtdClassId::toString() const {
-static RcString nul("[null]");
-
-	return(length_ == 0 ? nul : HexFormatter::binToHex(&bytes_[1], length_));
+	return(length_ == 0 ? nullString.str() : HexFormatter::binToHex(&bytes_[1], length_));
 }
 
 ARTD_END
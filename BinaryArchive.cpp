@@ -0,0 +1,360 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/BinaryArchive.h"
+#include "artd/MappedFile.h"
+#include <cstdio>
+#include <cstring>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+namespace {
+
+static const char Magic[8] = { 'A','R','T','D','A','R','C', 0 };
+static const uint32_t Version = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint64_t tableOffset;
+	int32_t root;
+	uint32_t byteOrder;
+};
+
+// follows the entry header of an array
+struct ArrayInfo
+{
+	uint32_t elemSize;
+	uint32_t reserved;
+};
+
+INL size_t align8(size_t n) {
+	return(ARTD_ALIGN_UP(n, 8));
+}
+
+} // namespace
+
+struct BinaryArchive::Entry
+{
+	uint32_t type;
+	uint32_t length;
+
+	INL const uint8_t *payload() const { return((const uint8_t *)(this + 1)); }
+};
+
+BinaryArchive::BinaryArchive(const ByteArray &image)
+{
+	if(!image || (size_t)image.length() < sizeof(Header)) {
+		return;
+	}
+	const uint8_t *base = image.elements();
+	const size_t size = (size_t)image.length();
+	const Header *h = (const Header *)base;
+	if(::memcmp(h->magic, Magic, sizeof(Magic)) != 0 || h->version != Version
+		|| h->byteOrder != ByteOrderMark || (((uintptr_t)base) & 7) != 0) {
+		return;
+	}
+	if(h->tableOffset > size || (size - h->tableOffset) / sizeof(uint64_t) < h->count
+		|| (h->tableOffset & 7) != 0 || h->count > 0x7FFFFFFF) {
+		return;
+	}
+	const uint64_t *table = (const uint64_t *)(base + h->tableOffset);
+
+	// check every entry lies in the image so the accessors don't need to
+	for(uint32_t i = 0; i < h->count; ++i) {
+		const uint64_t ofs = table[i];
+		if(ofs < sizeof(Header) || (ofs & 7) != 0 || ofs > h->tableOffset - sizeof(Entry)) {
+			return;
+		}
+		const Entry *e = (const Entry *)(base + ofs);
+		const uint64_t room = h->tableOffset - ofs - sizeof(Entry);
+		uint64_t need;
+		switch(e->type) {
+			case tSTRING:
+				need = (uint64_t)e->length + 1;
+				if(need <= room && e->payload()[e->length] != 0) {
+					return;
+				}
+				break;
+			case tARRAY:
+				need = sizeof(ArrayInfo);
+				if(need <= room) {
+					need += (uint64_t)e->length * ((const ArrayInfo *)e->payload())->elemSize;
+				}
+				break;
+			case tUUID:
+				need = sizeof(Uuid);
+				if(e->length != sizeof(Uuid)) {
+					return;
+				}
+				break;
+			case tCLASSID:
+				need = e->length;
+				if(e->length > ArtdClassId::MaxLength + 1) {
+					return;
+				}
+				break;
+			case tLIST:
+				need = (uint64_t)e->length * sizeof(uint32_t);
+				if(need <= room) {
+					const uint32_t *items = (const uint32_t *)e->payload();
+					for(uint32_t j = 0; j < e->length; ++j) {
+						if(items[j] >= h->count) {
+							return;
+						}
+					}
+				}
+				break;
+			default:
+				return;
+		}
+		if(need > room) {
+			return;
+		}
+	}
+	if(h->count > 0 && (h->root < 0 || (uint32_t)h->root >= h->count)) {
+		return;
+	}
+	image_ = image;
+	table_ = table;
+	count_ = (int)h->count;
+	root_ = h->root;
+}
+
+BinaryArchive
+BinaryArchive::open(const char *path)
+{
+	return(BinaryArchive(MappedFile::map(path)));
+}
+
+const BinaryArchive::Entry *
+BinaryArchive::entry(int ix, EntryType type) const
+{
+	if((unsigned int)ix >= (unsigned int)count()) {
+		return(nullptr);
+	}
+	const Entry *e = (const Entry *)(image_.elements() + table_[ix]);
+	return(e->type == (uint32_t)type ? e : nullptr);
+}
+
+BinaryArchive::EntryType
+BinaryArchive::type(int ix) const
+{
+	if((unsigned int)ix >= (unsigned int)count()) {
+		return(tNONE);
+	}
+	return((EntryType)((const Entry *)(image_.elements() + table_[ix]))->type);
+}
+
+std::string_view
+BinaryArchive::stringView(int ix) const
+{
+	const Entry *e = entry(ix, tSTRING);
+	if(!e) {
+		return(std::string_view());
+	}
+	return(std::string_view((const char *)e->payload(), e->length));
+}
+
+RcString
+BinaryArchive::string(int ix) const
+{
+	const Entry *e = entry(ix, tSTRING);
+	if(!e) {
+		return(nullptr);
+	}
+	return(RcString::createForSize((int)e->length, (const char *)e->payload()));
+}
+
+void *
+BinaryArchive::arrayElements(int ix, int elemSize, int *length) const
+{
+	const Entry *e = entry(ix, tARRAY);
+	if(!e || ((const ArrayInfo *)e->payload())->elemSize != (uint32_t)elemSize || e->length > 0x7FFFFFFF) {
+		return(nullptr);
+	}
+	*length = (int)e->length;
+	return((void *)(e->payload() + sizeof(ArrayInfo)));
+}
+
+Uuid
+BinaryArchive::uuid(int ix) const
+{
+	Uuid id;
+	const Entry *e = entry(ix, tUUID);
+	if(e) {
+		::memcpy((void *)&id, e->payload(), sizeof(id));
+	} else {
+		::memset((void *)&id, 0, sizeof(id));
+	}
+	return(id);
+}
+
+ArtdClassId
+BinaryArchive::classId(int ix) const
+{
+	const Entry *e = entry(ix, tCLASSID);
+	if(!e) {
+		return(ArtdClassId());
+	}
+	return(ArtdClassId((int)e->length, (const char *)e->payload()));
+}
+
+int
+BinaryArchive::listSize(int ix) const
+{
+	const Entry *e = entry(ix, tLIST);
+	return(e ? (int)e->length : 0);
+}
+
+int
+BinaryArchive::listItem(int ix, int i) const
+{
+	const Entry *e = entry(ix, tLIST);
+	ARTD_ASSERT(e && (unsigned int)i < e->length);
+	return((int)((const uint32_t *)e->payload())[i]);
+}
+
+// ********* writer
+
+BinaryArchiveWriter::BinaryArchiveWriter()
+{
+	Header h;
+	::memset(&h, 0, sizeof(h)); // header is filled in by finish()
+	appendBytes(&h, sizeof(h));
+}
+
+void
+BinaryArchiveWriter::appendBytes(const void *data, size_t size)
+{
+	bytes_.append((const uint8_t *)data, (int)size);
+}
+
+void
+BinaryArchiveWriter::pad()
+{
+	static const uint8_t zeros[8] = { 0 };
+	appendBytes(zeros, align8(bytes_.size()) - bytes_.size());
+}
+
+int
+BinaryArchiveWriter::beginEntry(BinaryArchive::EntryType type, uint32_t length)
+{
+	pad();
+	offsets_.push_back((uint64_t)bytes_.size());
+	BinaryArchive::Entry e = { (uint32_t)type, length };
+	appendBytes(&e, sizeof(e));
+	return(offsets_.size() - 1);
+}
+
+int
+BinaryArchiveWriter::addString(const StringArg &s)
+{
+	const int len = s.c_str() ? s.length() : 0;
+	int ix = beginEntry(BinaryArchive::tSTRING, (uint32_t)len);
+	appendBytes(s.c_str(), len);
+	appendBytes("", 1);
+	return(ix);
+}
+
+int
+BinaryArchiveWriter::addArrayBytes(const void *elements, int length, int elemSize)
+{
+	int ix = beginEntry(BinaryArchive::tARRAY, (uint32_t)length);
+	ArrayInfo info = { (uint32_t)elemSize, 0 };
+	appendBytes(&info, sizeof(info));
+	appendBytes(elements, (size_t)length * elemSize);
+	return(ix);
+}
+
+int
+BinaryArchiveWriter::addUuid(const Uuid &id)
+{
+	int ix = beginEntry(BinaryArchive::tUUID, sizeof(Uuid));
+	appendBytes(&id, sizeof(Uuid));
+	return(ix);
+}
+
+int
+BinaryArchiveWriter::addClassId(const ArtdClassId &id)
+{
+	uint8_t buf[ArtdClassId::MaxLength + 1];
+	int len = id.getBytes(buf);
+	int ix = beginEntry(BinaryArchive::tCLASSID, (uint32_t)len);
+	appendBytes(buf, len);
+	return(ix);
+}
+
+int
+BinaryArchiveWriter::addList(const int *items, int count)
+{
+	int ix = beginEntry(BinaryArchive::tLIST, (uint32_t)count);
+	for(int i = 0; i < count; ++i) {
+		ARTD_ASSERT((unsigned int)items[i] < (unsigned int)ix);
+		uint32_t item = (uint32_t)items[i];
+		appendBytes(&item, sizeof(item));
+	}
+	return(ix);
+}
+
+ByteArray
+BinaryArchiveWriter::finish(int root)
+{
+	pad();
+	Header h;
+	::memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.count = (uint32_t)offsets_.size();
+	h.tableOffset = bytes_.size();
+	h.root = root;
+	h.byteOrder = ByteOrderMark;
+	appendBytes(offsets_.data(), offsets_.size() * sizeof(uint64_t));
+	::memcpy(bytes_.mutableData(), &h, sizeof(h));
+
+	ByteArray image = bytes_.freeze();
+	offsets_.clear();
+	appendBytes(&h, sizeof(h)); // ready to start another
+	return(image);
+}
+
+bool
+BinaryArchiveWriter::writeFile(const char *path, int root)
+{
+	ByteArray image = finish(root);
+	FILE *f = ::fopen(path, "wb");
+	if(!f) {
+		return(false);
+	}
+	bool ok = ::fwrite(image.elements(), 1, image.length(), f) == (size_t)image.length();
+	return(::fclose(f) == 0 && ok);
+}
+
+#undef INL
+
+ARTD_END
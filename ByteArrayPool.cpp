@@ -0,0 +1,187 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/ByteArrayPool.h"
+#include <cstdlib>
+#include <new>
+
+ARTD_BEGIN
+
+// a few free blocks per size class kept by each thread for ByteArrayPool::shared(),
+// taken and given without a lock
+class ByteArrayPoolCache
+{
+public:
+	static const int BlocksPerClass = 4;
+
+	struct Slot {
+		ByteArrayPool *pool = nullptr;
+		int count = 0;
+		void *blocks[BlocksPerClass];
+	};
+	Slot slots_[ByteArrayPool::NumClasses];
+
+	~ByteArrayPoolCache() {
+		for(int c = 0; c < ByteArrayPool::NumClasses; ++c) {
+			Slot &slot = slots_[c];
+			while(slot.count > 0) {
+				slot.pool->pooledBytes_ -= ByteArrayPool::classSize(c);
+				slot.pool->giveShared(slot.blocks[--slot.count], c);
+			}
+		}
+	}
+};
+
+static thread_local ByteArrayPoolCache threadCache;
+
+ByteArrayPool::ByteArrayPool(size_t maxPooledBytes)
+	: maxPooledBytes_(maxPooledBytes)
+	, threadCached_(false)
+	, pooledBytes_(0)
+	, heapAllocations_(0)
+{
+}
+
+ByteArrayPool::~ByteArrayPool()
+{
+	trim();
+}
+
+ByteArrayPool &
+ByteArrayPool::shared()
+{
+	static ByteArrayPool *pool = []() {
+		ByteArrayPool *p = new ByteArrayPool();
+		p->threadCached_ = true;
+		return(p);
+	}();
+	return(*pool);
+}
+
+int
+ByteArrayPool::classFor(size_t size)
+{
+	int c = 0;
+	while(classSize(c) < size) {
+		++c;
+	}
+	return(c);
+}
+
+ByteArray
+ByteArrayPool::acquire(int length, bool zeroed)
+{
+	const size_t needed = RcArrayBase::blockSizeFor(length, 1);
+	if(needed > MaxBlockSize) {
+		return(zeroed ? ByteArray(length) : ByteArray::uninitialized(length));
+	}
+	return(ByteArray(RcArrayObj<uint8_t>::cast(RcArrayBase::allocateFrom(this, classSize(classFor(needed)), length, 1, zeroed))));
+}
+
+void *
+ByteArrayPool::takeBlock(size_t blockSize)
+{
+	const int c = classFor(blockSize);
+	if(!threadCached_) {
+		return(takeShared(c));
+	}
+	ByteArrayPoolCache::Slot &slot = threadCache.slots_[c];
+	if(slot.pool == this && slot.count > 0) {
+		pooledBytes_ -= blockSize;
+		return(slot.blocks[--slot.count]);
+	}
+	return(takeShared(c));
+}
+
+void
+ByteArrayPool::giveBlock(void *block, size_t blockSize)
+{
+	const int c = classFor(blockSize);
+	if(!threadCached_) {
+		giveShared(block, c);
+		return;
+	}
+	ByteArrayPoolCache::Slot &slot = threadCache.slots_[c];
+	if(slot.count == 0) {
+		slot.pool = this;
+	}
+	if(slot.pool == this && slot.count < ByteArrayPoolCache::BlocksPerClass
+		&& pooledBytes_.load(std::memory_order_relaxed) + blockSize <= maxPooledBytes_)
+	{
+		pooledBytes_ += blockSize;
+		slot.blocks[slot.count++] = block;
+		return;
+	}
+	giveShared(block, c);
+}
+
+void *
+ByteArrayPool::takeShared(int sizeClass)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		std::vector<void *> &list = free_[sizeClass];
+		if(!list.empty()) {
+			void *block = list.back();
+			list.pop_back();
+			pooledBytes_ -= classSize(sizeClass);
+			return(block);
+		}
+	}
+	void *block = ::malloc(classSize(sizeClass));
+	if(!block) {
+		throw std::bad_alloc();
+	}
+	++heapAllocations_;
+	return(block);
+}
+
+void
+ByteArrayPool::giveShared(void *block, int sizeClass)
+{
+	const size_t size = classSize(sizeClass);
+	if(pooledBytes_.load(std::memory_order_relaxed) + size <= maxPooledBytes_) {
+		std::lock_guard<std::mutex> guard(lock_);
+		free_[sizeClass].push_back(block);
+		pooledBytes_ += size;
+		return;
+	}
+	::free(block);
+}
+
+void
+ByteArrayPool::trim()
+{
+	std::lock_guard<std::mutex> guard(lock_);
+	for(int c = 0; c < NumClasses; ++c) {
+		for(void *block : free_[c]) {
+			::free(block);
+		}
+		pooledBytes_ -= free_[c].size() * classSize(c);
+		free_[c].clear();
+		free_[c].shrink_to_fit();
+	}
+}
+
+ARTD_END
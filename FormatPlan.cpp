@@ -0,0 +1,363 @@
+/*-
+ * Copyright (c) 1991-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ * 
+ *  $Id$
+ */
+
+#include "artd/FormatPlan.h"
+#include <cstring>
+#include <cstdio>
+
+#define INL ARTD_ALWAYS_INLINE
+
+ARTD_BEGIN
+
+namespace {
+
+static INL bool isFlag(char c) {
+	return(c == '-' || c == '+' || c == ' ' || c == '#' || c == '0');
+}
+static INL bool isDigit(char c) {
+	return(c >= '0' && c <= '9');
+}
+
+// reads "n$" at i, returns n and moves i past it or 0 if there isn't one
+static int parseArgnum(const char *s, int &i)
+{
+	int j = i;
+	int num = 0;
+	if(s[j] < '1' || s[j] > '9') {
+		return(0);
+	}
+	while(isDigit(s[j])) {
+		num = (num * 10) + (s[j++] - '0');
+		if(num > 0xFFFF) {
+			return(0);
+		}
+	}
+	if(s[j] != '$') {
+		return(0);
+	}
+	i = j + 1;
+	return(num);
+}
+
+static const int CacheSize = 64; // per thread, direct mapped on the format pointer
+
+class FormatPlanCache
+{
+public:
+	const char *keys[CacheSize] = {};
+	ObjectPtr<FormatPlan> plans[CacheSize];
+};
+
+static thread_local FormatPlanCache planCache;
+
+} // namespace
+
+FormatPlan::FormatPlan(const char *fmt)
+	: argCount_(0)
+	, planned_(true)
+{
+	if(!fmt) {
+		fmt = "";
+	}
+	const int len = (int)::strlen(fmt);
+	fmt_.assign(fmt, fmt + len + 1);
+
+	const char *s = fmt_.data();
+	int nextArg = 0;
+	int litStart = 0;
+	int i = 0;
+
+	while(i < len)
+	{
+		if(s[i] != '%') {
+			++i;
+			continue;
+		}
+		if(s[i + 1] == '%') {
+			// literal up to and including the first '%'
+			ops_.push_back(Op{ opLITERAL, 0, 0, litStart, i + 1 - litStart });
+			i += 2;
+			litStart = i;
+			continue;
+		}
+		if(i > litStart) {
+			ops_.push_back(Op{ opLITERAL, 0, 0, litStart, i - litStart });
+		}
+		if(!parseSpec(i, nextArg)) {
+			planned_ = false;
+			ops_.clear();
+			specs_.clear();
+			return;
+		}
+		litStart = i;
+	}
+	if(i > litStart) {
+		ops_.push_back(Op{ opLITERAL, 0, 0, litStart, i - litStart });
+	}
+}
+
+FormatPlan::~FormatPlan()
+{
+}
+
+// parses the conversion at the '%' at s[i] as FormatfStreamBase does,
+// false for one it can't plan
+bool
+FormatPlan::parseSpec(int &i, int &nextArg)
+{
+	const char *s = fmt_.data();
+	const int specStart = i++;
+	bool plain = true;
+	bool dlong = false;
+	bool sized = false;      // h l L or ll given
+	bool precision = false;
+	bool starWidth = false;
+	int starArgs = 0;   // sequential '*' arguments
+	int starMax = 0;    // highest positional '*' argument
+	char flags[6] = {};
+
+	const int argnum = parseArgnum(s, i);
+	for(int nflags = 0; isFlag(s[i]); ++i) {
+		if(::strchr(flags, s[i])) {
+			return(false); // repeated flags are an error to FormatfStream
+		}
+		flags[nflags++] = s[i];
+		plain = false;
+	}
+	for(int part = 0; part < 2; ++part)
+	{
+		// width then .precision
+		if(part == 1) {
+			if(s[i] != '.') {
+				break;
+			}
+			plain = false;
+			precision = true;
+			++i;
+		}
+		if(s[i] == '*') {
+			plain = false;
+			starWidth = starWidth || part == 0;
+			++i;
+			const int starnum = parseArgnum(s, i);
+			if(!starnum) {
+				++starArgs;
+			} else if(starnum > starMax) {
+				starMax = starnum;
+			}
+		} else {
+			while(isDigit(s[i])) {
+				plain = false;
+				++i;
+			}
+		}
+	}
+	if(s[i] == 'h') {
+		plain = false;
+		sized = true;
+		++i;
+	} else if(s[i] == 'l' || s[i] == 'L') {
+		sized = true;
+		if(s[i + 1] == s[i]) {
+			dlong = true;
+		} else {
+			plain = false;
+		}
+		i += dlong ? 2 : 1;
+	}
+
+	const char c = s[i];
+	if(!c || !::strchr("cdiuoxXbpfeEgGsStw", c)) {
+		return(false); // invalid or %n
+	}
+	++i;
+
+	// what FormatfStream rejects for strings and chars, it prints the spec
+	// as text, which from here would be the rewritten spec
+	const bool otherFlags = flags[0] && (flags[0] != '-' || flags[1]);
+	if(::strchr("sStw", c) && (otherFlags || sized)) {
+		return(false);
+	}
+	if(c == 'c' && (otherFlags || sized || precision || starWidth)) {
+		return(false); // a '*' width of 0 is an error too
+	}
+
+	// mixing positional and sequential arguments in one conversion is left
+	// to FormatfStream
+	if(argnum ? starArgs != 0 : starMax != 0) {
+		return(false);
+	}
+
+	const int firstArg = argnum ? argnum - 1 : nextArg;
+	const int valueArg = argnum ? argnum - 1 : nextArg + starArgs;
+	nextArg = valueArg + 1;
+	if(nextArg > argCount_) {
+		argCount_ = nextArg;
+	}
+	if(starMax > argCount_) {
+		argCount_ = starMax;
+	}
+
+	if(plain)
+	{
+		uint8_t type = opFORMAT;
+		switch(c) {
+			case 'd': case 'i': type = opINT; break;
+			case 'u': type = opUINT; break;
+			case 's': case 't': type = dlong ? opFORMAT : opCHARS; break;
+			default: break;
+		}
+		if(type != opFORMAT) {
+			// the spec is kept for arguments the fast path doesn't handle
+			ops_.push_back(Op{ type, (uint8_t)dlong, (uint16_t)valueArg, addSpec(specStart, i, firstArg, argnum != 0), 0 });
+			return(true);
+		}
+	}
+	ops_.push_back(Op{ opFORMAT, 0, (uint16_t)firstArg, addSpec(specStart, i, firstArg, argnum != 0), 0 });
+	return(true);
+}
+
+// a spec for FormatfStream, run over all the arguments. A sequential spec
+// is made positional at its first argument so it picks up where it belongs
+// ie: "%-8.3f" is "%3$-8.3f" when it is the 3rd argument.
+int
+FormatPlan::addSpec(int specStart, int specEnd, int firstArg, bool positional)
+{
+	const int start = (int)specs_.size();
+	specs_.push_back('%');
+	if(!positional) {
+		char digits[16];
+		int n = ::snprintf(digits, sizeof(digits), "%d$", firstArg + 1);
+		specs_.insert(specs_.end(), digits, digits + n);
+	}
+	specs_.insert(specs_.end(), fmt_.data() + specStart + 1, fmt_.data() + specEnd);
+	specs_.push_back(0);
+	return(start);
+}
+
+void
+FormatPlan::writeSpec(FormatfBuffer &out, const Op &op, const Arg *args, int count) const
+{
+	FormatfStream fs;
+	fs.va_init(specs_.data() + op.start, args, count);
+	fs.writeTo(out);
+}
+
+void
+FormatPlan::write(FormatfBuffer &out, const Arg *args, int count) const
+{
+	if(!planned_ || count < argCount_) {
+		// FormatfStream as a whole, as the plan can't do better
+		FormatfStream fs;
+		fs.va_init(fmt_.data(), args, count);
+		fs.writeTo(out);
+		return;
+	}
+
+	const char *s = fmt_.data();
+	for(const Op &op : ops_)
+	{
+		const Arg *arg = args + op.arg;
+		switch(op.type)
+		{
+			case opLITERAL:
+				out.append(s + op.start, op.length);
+				continue;
+			case opINT:
+				// read as FormatfStream does, "ll" for 64 bits else an int
+				out.appendInt(op.dlong ? arg->value_.int64_ : (int64_t)arg->value_.int_);
+				continue;
+			case opUINT:
+				out.appendUInt(op.dlong ? arg->value_.uint64_ : (uint64_t)arg->value_.uint_);
+				continue;
+			case opCHARS:
+				if(arg->type_ == FormatfArgBase::tCHARS) {
+					if(!arg->value_.chars_) {
+						out.appendChars(nullptr);
+					} else if(arg->len_ >= 0) {
+						out.append(arg->value_.chars_, arg->len_);
+					} else {
+						out.appendChars(arg->value_.chars_);
+					}
+					continue;
+				}
+				if(arg->type_ == FormatfArgBase::tRCSTR && arg->value_.obj_) {
+					const RcString::ObjT *str = static_cast<const RcString::ObjT *>(arg->value_.obj_);
+					out.append(str->c_str(), str->length());
+					continue;
+				}
+				break;
+			default:
+				break;
+		}
+		// opFORMAT or an argument the fast path doesn't handle
+		writeSpec(out, op, args, count);
+	}
+}
+
+int
+FormatPlan::vwriteTo(FormatfSink &sink, const FormatfArglist<> &args) const
+{
+	FormatfBuffer out;
+	write(out, args.args(), args.argCount());
+	sink.write(out.data(), out.length());
+	return(out.length());
+}
+
+RcString
+FormatPlan::vformat(const FormatfArglist<> &args) const
+{
+	FormatfBuffer out;
+	write(out, args.args(), args.argCount());
+	return(RcString::createForSize(out.length(), out.data()));
+}
+
+ObjectPtr<FormatPlan>
+FormatPlan::parse(const char *fmt)
+{
+	return(ObjectBase::make<FormatPlan>(fmt));
+}
+
+ObjectPtr<FormatPlan>
+FormatPlan::cached(const char *fmt)
+{
+	if(!fmt) {
+		return(parse(fmt));
+	}
+	FormatPlanCache &cache = planCache;
+	const int slot = (int)((((uintptr_t)fmt) >> 3) % CacheSize);
+	ObjectPtr<FormatPlan> &plan = cache.plans[slot];
+	if(cache.keys[slot] == fmt && plan) {
+		if(::strcmp(plan->fmt_.data(), fmt) == 0) {
+			return(plan);
+		}
+	}
+	plan = parse(fmt);
+	cache.keys[slot] = fmt;
+	return(plan);
+}
+
+ARTD_END
+
+#undef INL
@@ -24,6 +24,7 @@
 
 #include "artd/pointer_math.h"
 #include "artd/Formatf.h"
+#include "artd/FormatfSink.h"
 
 #include <ctype.h>
 #include <math.h>
@@ -34,6 +35,17 @@
 	#include <float.h>
 #endif
 
+#if defined(__has_include)
+	#if __has_include(<charconv>)
+		#include <charconv>
+	#endif
+#endif
+// with std::to_chars() doubles are formatted exactly and correctly rounded,
+// otherwise with the approximate divide and truncate code
+#if defined(__cpp_lib_to_chars)
+	#define FORMATF_TO_CHARS
+#endif
+
 // defining this will compile for utf8 encoding on char *strings.
 // otherwise they are treated as full 8 bit chars.
 #define FORMATF_UTF8
@@ -113,16 +125,43 @@ public:
 	int		        precis_;
 	int		        strlen_;
 	char *	        str_;       // string pointer when outputting string chars.
+	const void *    strend_;    // end of str_ for the getBounded string getters
+	int             argLen_;    // length of the last pointer argument if known or -1
 	double          darg_;
 	short			outflags_;  // for output encoding when reading to char *buffer
 	short			outatom_;   // length of remaining output atom (for utf8)
-	char	        strbuf_[68];// needs to be big enough to hold largest formatted
-								// double or 64 bit integer (as a string)
+	char	        strbuf_[360];// needs to be big enough to hold largest formatted
+								// double or 64 bit integer (as a string), DBL_MAX
+								// as "%.40f" is 309 + 1 + 40 digits after the sign
 
 	INL RcString& bufRcString() {
 		return(*reinterpret_cast<RcString*>(&strbuf_[50]));
 	}
 
+	// string getters for arguments of known length that may not be null terminated
+	static GetcRet getBoundedUtf8(FormatfStreamBase *fa_, const void **buf)
+	{
+		const char *p = (const char *)*buf;
+		const char *end = (const char *)(fa(fa_)->strend_);
+		if(p >= end) {
+			return(0);
+		}
+		if(Utf8::utfInSize((unsigned char)*p) > (int)(end - p)) {
+			*buf = end; // truncated sequence
+			return(0xFFFD);
+		}
+		return(Utf8::decode1((const char **)buf));
+	}
+	static GetcRet getBoundedWchar(FormatfStreamBase *fa_, const void **buf)
+	{
+		const wchar_t *p = (const wchar_t *)*buf;
+		if(p >= (const wchar_t *)(fa(fa_)->strend_)) {
+			return(0);
+		}
+		*buf = p + 1;
+		return(*p);
+	}
+
 	/* ignore all chars and arguments, returning the format type chars only */
 	static GetcRet do_parsechar(FormatfPrivate *fa)
 	{
@@ -237,6 +276,43 @@ private:
 		fa->fmt_ = nextdigit;
 		return(strtoi(digits));
 	}
+	/** if the format has "n$" next moves past it and returns n, else returns 0 */
+	static int get_argnum(FormatfPrivate *fa)
+	{
+		const void *fmt = fa->fmt_;
+		int num = 0;
+		int digit = fa->nextfmtchar_(fa,&fmt);
+
+		if(digit < '1' || digit > '9') {
+			return(0);
+		}
+		do {
+			num = (num * 10) + (digit - '0');
+			if(num > 0xFFFF) {
+				return(0);
+			}
+			digit = fa->nextfmtchar_(fa,&fmt);
+		} while(isdigit(digit));
+
+		if(digit != '$') {
+			return(0);
+		}
+		fa->fmt_ = fmt;
+		return(num);
+	}
+	/** positions the argument list at argument argnum (from 1) */
+	static bool select_arg(FormatfPrivate *fa, int argnum)
+	{
+		if(fa->mflags_ & fa->PARSE_MODE) {
+			return(true);
+		}
+		if(fa->arg_ != &fa->arglistGetter_ || argnum > fa->argCount_) {
+			fa->error_ = fa->Err_bad_argnum;
+			return(false);
+		}
+		fa->argbuf_.args = fa->argBase_ + (argnum - 1);
+		return(true);
+	}
 	static GetcRet trail_spaces(FormatfPrivate *fa)
 	{
 		if(!(--fa->width_))
@@ -263,9 +339,16 @@ private:
 	// limits string to precision length
 	{
 		void *ppstr = &(fa->str_);
-		int nextc = fa->nextstrchar_(fa,(const void **)ppstr);
+		int nextc = 0;
 
-		if((nextc == 0) || (fa->precis_ == 0))
+		if(fa->precis_ > 0) {
+			nextc = fa->nextstrchar_(fa,(const void **)ppstr);
+		}
+		if(nextc != 0) {
+			--fa->precis_;
+			--fa->width_;
+		}
+		else
 		{
 			if(fa->width_ > 0)
 				fa->setGetch(trail_spaces);
@@ -619,10 +702,10 @@ private:
 	{
 		fa->str_ = fa->strbuf_;
 		fa->prefix_ = fa->strbuf_;
-		if(fa->darg_ < 0.0)
+		if(std::signbit(fa->darg_)) // -0.0 too, so the digits never have a sign
 		{
 			*fa->str_++ = '-';
-			fa->darg_ = -fa->darg_;
+			fa->darg_ = std::fabs(fa->darg_);
 		}
 		else
 		{
@@ -658,6 +741,42 @@ private:
 		return(pmult);
 	}
 
+#ifdef FORMATF_TO_CHARS
+
+	enum { MaxToCharsPrecision = 40 };
+
+	/** puts the digits of fa->darg_ with precis_ places after the point in fa->str_,
+	 *  correctly rounded. 'G' mode chops off trailing zeros.
+	 *  returns the end of them or null if they will not fit in strbuf_.
+	 */
+	static char *fixed_digits(FormatfPrivate *fa, bool gmode)
+	{
+		if(!(fa->pflags_ & (FSPEC_GOTPCIS|FSPEC_0PCIS)))
+			fa->precis_ = 6;
+		else if(((unsigned)fa->precis_) > MaxToCharsPrecision)
+			fa->precis_ = MaxToCharsPrecision;
+
+		char *end = fa->strbuf_ + sizeof(fa->strbuf_) - 1;
+		std::to_chars_result r = std::to_chars(fa->str_, end, std::fabs(fa->darg_), std::chars_format::fixed, fa->precis_);
+		if(r.ec != std::errc()) {
+			return(0);
+		}
+		char *suffix = r.ptr;
+		if(gmode && fa->precis_ > 0)
+		{
+			while(suffix[-1] == '0')
+				--suffix;
+			if(suffix[-1] == '.')
+				--suffix;
+		}
+		*suffix = 0;
+		fa->zeropad_ = 0;
+		fa->strlen_ += (int)(suffix - fa->str_);
+		return(suffix);
+	}
+
+#endif // FORMATF_TO_CHARS
+
 	static void pcis_roundit(FormatfPrivate *fa)
 	{
 		if(!(fa->pflags_ & (FSPEC_GOTPCIS|FSPEC_0PCIS)))
@@ -773,6 +892,12 @@ private:
 			}
 		}
 		start_double(fa);
+	#ifdef FORMATF_TO_CHARS
+		if(fixed_digits(fa,0)) {
+			return(finish_num_string(fa));
+		}
+		// strbuf_ holds any double, this is not reached
+	#endif
 		pcis_roundit(fa);
 		add_dubldigits(fa,0);
 		return(finish_num_string(fa));
@@ -793,6 +918,50 @@ private:
 		start_double(fa);
 		darg = fa->darg_;
 
+	#ifdef FORMATF_TO_CHARS
+		{
+			if(!(fa->pflags_ & (FSPEC_GOTPCIS|FSPEC_0PCIS)))
+				fa->precis_ = 6;
+			else if(((unsigned)fa->precis_) > MaxToCharsPrecision)
+				fa->precis_ = MaxToCharsPrecision;
+
+			// the rounded mantissa and exponent "d.dddde+dd"
+			char sci[MaxToCharsPrecision + 16];
+			std::to_chars_result r = std::to_chars(sci, sci + sizeof(sci) - 1, std::fabs(darg), std::chars_format::scientific, fa->precis_);
+			if(r.ec == std::errc())
+			{
+				*r.ptr = 0;
+				char *pexp = strchr(sci,'e');
+				exp = atoi(pexp + 1);
+
+				if(gmode && (exp >= -4 && exp < fa->precis_))
+				{
+					if(fixed_digits(fa,1)) {
+						return(finish_num_string(fa));
+					}
+				}
+				else
+				{
+					if(gmode && fa->precis_ > 0) // chop zeros
+					{
+						while(pexp[-1] == '0')
+							--pexp;
+						if(pexp[-1] == '.')
+							--pexp;
+					}
+					len = (int)(pexp - sci);
+					memcpy(fa->str_,sci,len);
+					fa->strlen_ += len;
+					fa->zeropad_ = 0;
+					suffix = fa->str_ + len;
+					goto add_exponent;
+				}
+			}
+			// too long for strbuf_
+			exp = 0;
+		}
+	#endif
+
 		// shift over by base 10 radix until we get to d.dddd fit
 
 		if(darg != 0.0)
@@ -837,6 +1006,9 @@ private:
 
 		suffix = add_dubldigits(fa,gmode);
 
+#ifdef FORMATF_TO_CHARS
+	add_exponent:
+#endif
 		if(isupper(lastchar))
 			*suffix++ = 'E';
 		else
@@ -879,6 +1051,99 @@ private:
 		return(0);
 	}
 
+	static INL bool isUtf8Getter(GetBufChar getch)
+	{
+		return(getch == getBufCharUtf8 || getch == getBufChar8);
+	}
+	static INL bool isAscii(char c)
+	{
+		return(((unsigned char)(c - 1)) < 0x7F); // not 0 and < 0x80
+	}
+
+	/** If the next output from the current state is a run of ascii chars
+	 *  that is already in memory, the format string, a string argument or a
+	 *  formatted number, or is space padding, this puts the run in *span
+	 *  and advances the state past it as if get() were called for each char.
+	 *  Returns the number of chars or 0 if the next char has to come from get().
+	 */
+	static int get_span(FormatfPrivate *fa, const char **span, int maxChars)
+	{
+		static const char spaces[] = "                                ";
+		GetchT state = fa->fgetch_;
+		int n = 0;
+
+		if(maxChars <= 0) {
+			return(0);
+		}
+		if(state == fa->root_)
+		{
+			// literal text in the format up to the next '%'
+			if(state != FormatfStreamBase::geta_fmtchar || !isUtf8Getter(fa->nextfmtchar_)) {
+				return(0);
+			}
+			const char *p = (const char *)fa->fmt_;
+			while(n < maxChars && isAscii(p[n]) && p[n] != '%') {
+				++n;
+			}
+			*span = p;
+			fa->fmt_ = p + n;
+		}
+		else if(state == (GetchT)get_len_str)
+		{
+			// a string argument
+			if(!isUtf8Getter(fa->nextstrchar_) && fa->nextstrchar_ != getBoundedUtf8) {
+				return(0);
+			}
+			const char *p = fa->str_;
+			int max = fa->strlen_ < maxChars ? fa->strlen_ : maxChars;
+			if(fa->nextstrchar_ == getBoundedUtf8 && (const char *)fa->strend_ - p < max) {
+				max = (int)((const char *)fa->strend_ - p);
+			}
+			while(n < max && isAscii(p[n])) {
+				++n;
+			}
+			*span = p;
+			fa->str_ += n;
+			fa->strlen_ -= n;
+		}
+		else if(state == (GetchT)get_str)
+		{
+			// formatted number digits in strbuf_
+			const char *p = fa->str_;
+			while(n < maxChars && p[n] != 0) {
+				++n;
+			}
+			if(n == 0) {
+				return(0);
+			}
+			*span = p;
+			fa->str_ += n;
+			fa->width_ -= n;
+			if(fa->str_[0] == 0) {
+				if(fa->width_ > 0)
+					fa->setGetch(trail_spaces);
+				else
+					fa->fgetch_ = fa->root_;
+			}
+		}
+		else if(state == (GetchT)trail_spaces || state == (GetchT)rjust_get_str || state == (GetchT)rjust_pfix_str)
+		{
+			n = fa->width_;
+			if(n > maxChars) n = maxChars;
+			if(n > (int)sizeof(spaces) - 1) n = (int)sizeof(spaces) - 1;
+			if(n <= 0) {
+				return(0);
+			}
+			*span = spaces;
+			fa->width_ -= n;
+			if(fa->width_ == 0 && state == (GetchT)trail_spaces) {
+				fa->setGetch(fa->root_);
+			}
+		}
+		fa->count_ += n;
+		return(n);
+	}
+
 public:
 
 	static GetcRet geta_fmtchar(FormatfPrivate *fa)
@@ -888,6 +1153,8 @@ public:
 	GetcRet retchar;
 	unsigned short flags;
 	int typechar = 0;
+	int convArg;   // positional "%n$" argument of the conversion
+	int starArg;   // positional "*n$" argument of a width or precision
 
 	get_another_char: // here from below to reset things and dump format chars
 
@@ -910,6 +1177,10 @@ public:
 		fa->width_ = 0;
 		fa->precis_ = 0;
 
+		convArg = get_argnum(fa); // posix positional "%n$"
+		if(convArg && !select_arg(fa,convArg))
+			goto error;
+
 		for(;;)
 		{
 			retchar = fa->nextfmtchar_(fa,&fa->fmt_);
@@ -945,6 +1216,9 @@ public:
 					flags = FSPEC_GOTDOT;
 					goto check_ctflags;
 				case '*':
+					starArg = get_argnum(fa);
+					if(starArg && !select_arg(fa,starArg))
+						goto error;
 					if(fa->pflags_ & FSPEC_GOTDOT)
 					{
 						flags = FSPEC_GOTPCIS;
@@ -963,6 +1237,8 @@ public:
 						if(0 == (fa->width_ = getArgInt(fa)))
 							flags = FSPEC_0WID;
 					}
+					if(starArg && convArg) // back to the conversion's argument
+						select_arg(fa,convArg);
 					goto check_ctflags;
 				inc_pstars:
 					++fa->parse_stars_;
@@ -973,6 +1249,8 @@ public:
 					{
 						if(fa->pflags_)
 							goto error;
+						if(retchar == 0) // format ended in a '%', fmt_ is past the null
+							fa->setGetch(returnNullChar);
 						goto done;
 					}
 
@@ -1176,14 +1454,26 @@ public:
 								}
 								break;
 							case FormatfArgBase::tRCSTR:  // first releasable object type
+								fa->argLen_ = static_cast<const RcString::ObjT *>(pstr)->length();
 								pstr = static_cast<const RcString::ObjT *>(pstr)->c_str();
 							case FormatfArgBase::tCHARS:
-								fa->nextstrchar_ = getBufCharUtf8;
+								if(fa->argLen_ >= 0) {
+									fa->strend_ = (const char *)pstr + fa->argLen_;
+									fa->nextstrchar_ = getBoundedUtf8;
+								} else {
+									fa->nextstrchar_ = getBufCharUtf8;
+								}
 								break;
 							case FormatfArgBase::tRCWSTR:
+								fa->argLen_ = static_cast<const RcWString::ObjT *>(pstr)->length();
 								pstr = static_cast<const RcWString::ObjT *>(pstr)->c_str();
 							case FormatfArgBase::tWCHARS:
-								fa->nextstrchar_ = getBufWchar;
+								if(fa->argLen_ >= 0) {
+									fa->strend_ = (const wchar_t *)pstr + fa->argLen_;
+									fa->nextstrchar_ = getBoundedWchar;
+								} else {
+									fa->nextstrchar_ = getBufWchar;
+								}
 								break;
 							case FormatfArgBase::tOBJECT: {
 								break;
@@ -1194,7 +1484,7 @@ public:
 								goto finish_string;
 						}
 						fa->str_ = (char *)pstr;
-						if(fa->nextfmtchar_(fa,(const void **)&pstr) == 0)
+						if(fa->nextstrchar_(fa,(const void **)&pstr) == 0)
 						{
 							if(!(fa->pflags_ & FSPEC_GOTWID)) // print nothing
 								goto reset;
@@ -1300,50 +1590,52 @@ public:
 	}
 	static const void *getvArgPointer(FormatfStreamBase *fa)
 	{
+		FormatfPrivate::fa(fa)->argLen_ = -1;
 		return(va_arg(fa->argbuf_.va, void *));
 	}
 	static int64_t getvArgInt64(FormatfStreamBase *fa) {
 		return(va_arg(fa->argbuf_.va, int64_t));
 	}
 
-	// va_list arg getter functions used in arglistGetter
-	// TODO check arg array overrun as we have the info in this case
+	// FormatfArglist arg getter functions used in arglistGetter
 
-	static double getArglistDouble(FormatfStreamBase *fa) {
+	/** the next argument, an all zero one with error_ set if past the end */
+	static const Arg *nextArglistArg(FormatfStreamBase *fa) {
+		static const Arg noArg((const char *)0);
 		const Arg *arg = fa->argbuf_.args;
+		if(arg >= fa->argBase_ + fa->argCount_) {
+			fa->error_ = Err_bad_argnum;
+			fa->argType_ = FormatfArgBase::tNONE;
+			FormatfPrivate::fa(fa)->argLen_ = -1;
+			return(&noArg);
+		}
 		fa->argType_ = arg->type_;
 		fa->argbuf_.args = arg + 1;
-		return(arg->value_.double_);
+		return(arg);
+	}
+	static double getArglistDouble(FormatfStreamBase *fa) {
+		return(nextArglistArg(fa)->value_.double_);
 	}
 	static int getArglistInt(FormatfStreamBase *fa) {
-		const Arg *arg = fa->argbuf_.args;
-		fa->argType_ = arg->type_;
-		fa->argbuf_.args = arg + 1;
-		return(arg->value_.int_);
+		return(nextArglistArg(fa)->value_.int_);
 	}
 	static short getArglistShort(FormatfStreamBase *fa) {
-		const Arg *arg = fa->argbuf_.args;
-		fa->argType_ = arg->type_;
-		fa->argbuf_.args = arg + 1;
-		return((short)(arg->value_.int_));
+		return((short)(nextArglistArg(fa)->value_.int_));
 	}
 	static long getArglistLong(FormatfStreamBase *fa) {
-		const Arg *arg = fa->argbuf_.args;
-		fa->argType_ = arg->type_;
-		fa->argbuf_.args = arg + 1;
-		return((int32_t)(arg->value_.int_));
+		return((int32_t)(nextArglistArg(fa)->value_.int_));
 	}
 	static const void *getArglistPointer(FormatfStreamBase *fa) {
-		const Arg *arg = fa->argbuf_.args;
-		fa->argType_ = arg->type_;
-		fa->argbuf_.args = arg + 1;
+		const Arg *arg = nextArglistArg(fa);
+		if(arg->type_ == FormatfArgBase::tCHARS || arg->type_ == FormatfArgBase::tWCHARS) {
+			FormatfPrivate::fa(fa)->argLen_ = arg->len_;
+		} else {
+			FormatfPrivate::fa(fa)->argLen_ = -1;
+		}
 		return(arg->value_.ptr_);
 	}
 	static int64_t getArglistInt64(FormatfStreamBase *fa) {
-		const Arg *arg = fa->argbuf_.args;
-		fa->argType_ = arg->type_;
-		fa->argbuf_.args = arg + 1;
-		return(arg->value_.int64_);
+		return(nextArglistArg(fa)->value_.int64_);
 	}
 
 }; // end of FormatfPrivate;
@@ -1441,6 +1733,7 @@ static const char *const ArgFormats[
 void 
 FormatfStreamBase::va_init_one(FormatfArglist<>::Arg *theOne) {
 	argbuf_.args = theOne;
+	argBase_ = theOne;
 	argCount_ = 1;
 	root_ = geta_fmtchar;
 	arg_ = &arglistGetter_;
@@ -1471,28 +1764,109 @@ int FormatfStreamBase::get()
 	++count_;
 	return(fgetch_(this));
 }
+int FormatfStreamBase::getSpan(const char **span, int maxChars)
+{
+	return(FormatfPrivate::get_span(FormatfPrivate::fa(this), span, maxChars));
+}
+int FormatfStreamBase::writeTo(FormatfSink &sink)
+{
+FormatfPrivate &fa = *FormatfPrivate::fa(this);
+char buf[128];   // collects single chars and short spans to write in blocks
+int used = 0;
+int total = 0;
+const char *span;
+
+	if(fa.outflags_ & fa.OUTFLAG_HASATOM)  // left over from a read()
+	{
+		memcpy(buf,fa.strbuf_,fa.outatom_);
+		used = fa.outatom_;
+		fa.outflags_ &= ~fa.OUTFLAG_HASATOM;
+	}
+	for(;;)
+	{
+		if(used > (int)sizeof(buf) - 8) {
+			sink.write(buf,used);
+			total += used;
+			used = 0;
+		}
+		int n = getSpan(&span, 0x7FFFFFFF);
+		if(n > 0)
+		{
+			if(n <= (int)sizeof(buf) - 8 - used) {
+				memcpy(buf + used,span,n);
+				used += n;
+				continue;
+			}
+			if(used > 0) {
+				sink.write(buf,used);
+				total += used;
+				used = 0;
+			}
+			sink.write(span,n);
+			total += n;
+			continue;
+		}
+		int got = get();
+		if(got == 0)
+			break;
+#ifdef FORMATF_UTF8
+		if(got < 0x80) {
+			buf[used++] = (char)got;
+		} else if(Utf8::utfOutSize(got) < 0) {
+			fa.error_ = Err_invalid_utf8;
+			break;
+		} else {
+			used = (int)(Utf8::encode1(buf + used,got) - buf);
+		}
+#else
+		buf[used++] = (char)got;
+#endif
+	}
+	if(used > 0) {
+		sink.write(buf,used);
+		total += used;
+	}
+	return(total);
+}
 int FormatfStreamBase::lenf()
 {
 int len = 0;
+const char *span;
 
-	while(get() != 0)
+	for(;;)
+	{
+		int n = getSpan(&span, 0x7FFFFFFF);
+		if(n > 0) {
+			len += n;
+			continue;
+		}
+		if(get() == 0)
+			break;
 		++len;
+	}
 	return(len);
 }
 int FormatfStreamBase::sizef()
 {
 int len = 0;
+const char *span;
 
+	for(;;)
+	{
+		int n = getSpan(&span, 0x7FFFFFFF);
+		if(n > 0) {
+			len += n; // ascii chars are one byte
+			continue;
+		}
+		int got = get();
+		if(got == 0)
+			break;
 #ifdef FORMATF_UTF8
-	int got;
-	while((got = get()) != 0) {
-		got = Utf8::utfOutSize(got);
-		len += got;
-	}
+		len += Utf8::utfOutSize(got);
 #else
-	while(get() != 0)
 		++len;
 #endif
+	}
 	return(len);
 }
 
@@ -1516,6 +1890,7 @@ int len = 0;
 				}
 				memcpy(buf,fa.strbuf_,fa.outatom_);
 				buf += fa.outatom_;
+				cnt += fa.outatom_;
 				fa.outflags_ &= ~fa.OUTFLAG_HASATOM;
 				bytesleft -= fa.outatom_;
 			} 
@@ -1525,6 +1900,16 @@ int len = 0;
 				if(bytesleft <= 0) {
 					goto done;
 				}
+				const char *span;
+				int n = getSpan(&span, bytesleft);
+				if(n > 0)
+				{
+					memcpy(buf,span,n);
+					buf += n;
+					cnt += n;
+					bytesleft -= n;
+					continue;
+				}
 				int got = get();
 				if(got < 0x80) 
 				{		
@@ -1537,17 +1922,19 @@ int len = 0;
 					continue;
 				}
 				int utflen = Utf8::utfOutSize(got);
-				if((bytesleft -= utflen) < 0) 
+				if(utflen < 0) {
+					fa.error_ = Err_invalid_utf8;
+					return(-1);
+				}
+				if(utflen > bytesleft) 
 				{
 					// defer putting in output until next read()				
 					fa.outflags_ |= fa.OUTFLAG_HASATOM;
+					fa.outatom_ = (short)utflen;
 					Utf8::encode1(fa.strbuf_,got);
 					goto done;
 				}
-				if(utflen < 0) {
-					fa.error_ = Err_invalid_utf8;
-					return(-1);
-				}
+				bytesleft -= utflen;
 				cnt += utflen;
 				buf = Utf8::encode1(buf,got);
 			}
@@ -1578,10 +1965,21 @@ int FormatfStreamBase::read(wchar_t *buf,int maxbytes)
 // returns number of *bytes* read not number of chars.
 {
 int cnt = 0;
+const char *span;
 
 	maxbytes  -= (maxbytes % sizeof(*buf));
 	while(cnt < maxbytes)
 	{
+		int n = getSpan(&span, (maxbytes - cnt) / (int)sizeof(*buf));
+		if(n > 0)
+		{
+			const char *end = span + n;
+			while(span < end) {
+				*buf++ = *span++;
+			}
+			cnt += n * sizeof(*buf);
+			continue;
+		}
 		if((*buf = get()) == 0)
 			break;
 		++buf;
@@ -0,0 +1,346 @@
+/*-
+ * Copyright (c) 1991-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ * 
+ *  $Id$
+ */
+
+#include "artd/FormatfSink.h"
+#include "artd/cstring_util.h"
+#include <cstdlib>
+#include <new>
+
+#ifdef ARTD_WINDOWS
+	#include <io.h>
+#else
+	#include <errno.h>
+	#include <unistd.h>
+	#include <sys/socket.h>
+#endif
+
+ARTD_BEGIN
+
+FormatfSink::~FormatfSink()
+{
+}
+
+int
+FormatfSink::vprintf(const char *fmt, const FormatfArglist<> &args)
+{
+	FormatfStream fs;
+	fs.va_init(fmt, args);
+	return(fs.writeTo(*this));
+}
+
+int
+FormatfSink::vprintf(const wchar_t *fmt, const FormatfArglist<> &args)
+{
+	FormatfStream fs;
+	fs.va_init(fmt, args);
+	return(fs.writeTo(*this));
+}
+
+// ********* FormatfBuffer
+
+void
+FormatfBuffer::write(const char *utf8, int len)
+{
+	append(utf8, len);
+}
+
+FormatfBuffer::~FormatfBuffer()
+{
+	if(buf_ != inline_) {
+		::free(buf_);
+	}
+}
+
+void
+FormatfBuffer::grow(int needed)
+{
+	int cap = cap_ * 2;
+	if(cap - len_ < needed) {
+		cap = len_ + needed;
+	}
+	char *buf = (char *)::malloc(cap + 1); // room for c_str()'s null
+	if(!buf) {
+		throw std::bad_alloc();
+	}
+	::memcpy(buf, buf_, len_);
+	if(buf_ != inline_) {
+		::free(buf_);
+	}
+	buf_ = buf;
+	cap_ = cap;
+}
+
+void
+FormatfBuffer::appendInt(int64_t val)
+{
+	char digits[24];
+	append(digits, i64tostr(val, digits, 10));
+}
+
+void
+FormatfBuffer::appendUInt(uint64_t val)
+{
+	char digits[24];
+	append(digits, ul64tostr(val, digits, 10));
+}
+
+void
+FormatfBuffer::appendChars(const char *chars)
+{
+	if(!chars) {
+		chars = "(nil)";
+	}
+	append(chars, (int)::strlen(chars));
+}
+
+void
+FormatfBuffer::appendFormatted(const char *spec, const FormatfArglist<> &args)
+{
+	FormatfStream fs;
+	fs.va_init(spec, args);
+	fs.writeTo(*this);
+}
+
+const char *
+FormatfBuffer::c_str()
+{
+	if(len_ >= cap_) {
+		grow(1);
+	}
+	buf_[len_] = 0;
+	return(buf_);
+}
+
+int
+FormatfBuffer::copyTo(char *out, int maxchars) const
+{
+	if(maxchars <= 0) {
+		return(0);
+	}
+	int len = len_;
+	if(len > maxchars - 1) {
+		len = maxchars - 1;
+		// back up to the start of a utf8 character
+		while(len > 0 && (((unsigned char)buf_[len]) & 0xC0) == 0x80) {
+			--len;
+		}
+	}
+	::memcpy(out, buf_, len);
+	out[len] = 0;
+	return(len);
+}
+
+// ********* FormatfStringSink
+
+void
+FormatfStringSink::write(const char *utf8, int len)
+{
+	out_.append(utf8, len);
+}
+
+// ********* FormatfFdSink
+
+FormatfFdSink::FormatfFdSink(int fd, int bufferSize)
+	: fd_(fd)
+	, buf_(nullptr)
+	, used_(0)
+	, size_(bufferSize > 0 ? bufferSize : 0)
+	, failed_(false)
+	, notSocket_(false)
+{
+	if(size_ > 0) {
+		buf_ = (char *)::malloc(size_);
+		if(!buf_) {
+			throw std::bad_alloc();
+		}
+	}
+}
+
+FormatfFdSink::~FormatfFdSink()
+{
+	flush();
+	::free(buf_);
+}
+
+// returns the bytes written, fewer than len if it failed or would block
+int
+FormatfFdSink::writeFd(const char *data, int len)
+{
+	int done = 0;
+	while(done < len && !failed_) {
+	#ifdef ARTD_WINDOWS
+		int wrote = ::_write(fd_, data + done, (unsigned int)(len - done));
+	#else
+		ssize_t wrote;
+		#ifdef MSG_NOSIGNAL
+		if(!notSocket_) {
+			wrote = ::send(fd_, data + done, (size_t)(len - done), MSG_NOSIGNAL);
+			if(wrote < 0 && errno == ENOTSOCK) {
+				notSocket_ = true;
+				continue;
+			}
+		} else
+		#endif
+		{
+			wrote = ::write(fd_, data + done, (size_t)(len - done));
+		}
+		if(wrote < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				break; // kept for the next flush()
+			}
+		}
+	#endif
+		if(wrote <= 0) {
+			failed_ = true;
+			break;
+		}
+		done += (int)wrote;
+	}
+	return(done);
+}
+
+// appends to the buffer, growing it to hold output that is waiting to be written
+void
+FormatfFdSink::buffer(const char *data, int len)
+{
+	if(len > size_ - used_) {
+		int size = size_ * 2;
+		if(size < used_ + len) {
+			size = used_ + len;
+		}
+		char *buf = (char *)::realloc(buf_, size);
+		if(!buf) {
+			throw std::bad_alloc();
+		}
+		buf_ = buf;
+		size_ = size;
+	}
+	::memcpy(buf_ + used_, data, len);
+	used_ += len;
+}
+
+void
+FormatfFdSink::write(const char *utf8, int len)
+{
+	if(failed_ || len <= 0) {
+		return;
+	}
+	if(used_ > 0 && len > size_ - used_) {
+		flush();
+	}
+	if(used_ == 0 && len >= size_) {
+		// too big to be worth buffering
+		int wrote = writeFd(utf8, len);
+		if(failed_) {
+			return;
+		}
+		utf8 += wrote;
+		len -= wrote;
+	}
+	if(len > 0) {
+		buffer(utf8, len);
+	}
+}
+
+bool
+FormatfFdSink::flush()
+{
+	if(used_ > 0 && !failed_) {
+		int wrote = writeFd(buf_, used_);
+		if(failed_) {
+			used_ = 0;
+		} else if(wrote > 0) {
+			::memmove(buf_, buf_ + wrote, used_ - wrote);
+			used_ -= wrote;
+		}
+	}
+	return(!failed_ && used_ == 0);
+}
+
+// ********* FormatfRingSink
+
+FormatfRingSink::FormatfRingSink(int capacity)
+	: buf_(nullptr)
+	, cap_(capacity > 0 ? capacity : 1)
+	, head_(0)
+	, total_(0)
+{
+	buf_ = (char *)::malloc(cap_);
+	if(!buf_) {
+		throw std::bad_alloc();
+	}
+}
+
+FormatfRingSink::~FormatfRingSink()
+{
+	::free(buf_);
+}
+
+void
+FormatfRingSink::write(const char *utf8, int len)
+{
+	total_ += (uint64_t)len;
+	if(len >= cap_) {
+		// only the tail fits
+		::memcpy(buf_, utf8 + (len - cap_), cap_);
+		head_ = 0;
+		return;
+	}
+	int first = cap_ - head_;
+	if(first > len) {
+		first = len;
+	}
+	::memcpy(buf_ + head_, utf8, first);
+	::memcpy(buf_, utf8 + first, len - first);
+	head_ += len;
+	if(head_ >= cap_) {
+		head_ -= cap_;
+	}
+}
+
+int
+FormatfRingSink::copyTo(char *out, int maxbytes) const
+{
+	int held = size();
+	if(maxbytes > held) {
+		maxbytes = held;
+	}
+	if(maxbytes <= 0) {
+		return(0);
+	}
+	// oldest byte is at head_ once the ring has wrapped, else at 0
+	int start = (total_ > (uint64_t)cap_) ? head_ : (head_ - held + cap_) % cap_;
+	int first = cap_ - start;
+	if(first > maxbytes) {
+		first = maxbytes;
+	}
+	::memcpy(out, buf_ + start, first);
+	::memcpy(out + first, buf_, maxbytes - first);
+	return(maxbytes);
+}
+
+ARTD_END
@@ -0,0 +1,213 @@
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/MappedFile.h"
+#include <climits>
+
+#ifdef ARTD_WINDOWS
+	#include <windows.h>
+	#include <string>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+ARTD_BEGIN
+
+namespace {
+
+/**
+ * ByteArray object whose elements are a mapped view of a file,
+ * the view is unmapped when the object is destroyed.
+ */
+class MappedBytes
+	: public RcArrayObj<uint8_t>
+{
+	void *view_;
+	size_t viewSize_;
+public:
+	MappedBytes(int length, uint8_t *bytes, void *view, size_t viewSize)
+		: RcArrayObj<uint8_t>(length, bytes)
+		, view_(view)
+		, viewSize_(viewSize)
+	{
+	}
+	~MappedBytes() override {
+	#ifdef ARTD_WINDOWS
+		::UnmapViewOfFile(view_);
+	#else
+		::munmap(view_, viewSize_);
+	#endif
+	}
+};
+
+#ifdef ARTD_WINDOWS
+
+class OpenFile
+{
+public:
+	HANDLE h_;
+
+	OpenFile(const char *path) : h_(INVALID_HANDLE_VALUE) {
+		int wlen = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+		if(wlen <= 0) {
+			return;
+		}
+		std::wstring wpath(wlen, L'\0');
+		::MultiByteToWideChar(CP_UTF8, 0, path, -1, &wpath[0], wlen);
+		h_ = ::CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+						   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	}
+	~OpenFile() {
+		if(isOpen()) {
+			::CloseHandle(h_);
+		}
+	}
+	bool isOpen() const { return(h_ != INVALID_HANDLE_VALUE); }
+
+	int64_t size() const {
+		LARGE_INTEGER sz;
+		if(!::GetFileSizeEx(h_, &sz)) {
+			return(-1);
+		}
+		return(sz.QuadPart);
+	}
+	static int64_t viewAlignment() {
+		SYSTEM_INFO si;
+		::GetSystemInfo(&si);
+		return(si.dwAllocationGranularity);
+	}
+	void *mapView(int64_t offset, size_t size) {
+		HANDLE hMap = ::CreateFileMappingW(h_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if(!hMap) {
+			return(nullptr);
+		}
+		void *view = ::MapViewOfFile(hMap, FILE_MAP_COPY, (DWORD)(offset >> 32), (DWORD)offset, size);
+		::CloseHandle(hMap); // the view keeps the mapping alive
+		return(view);
+	}
+};
+
+#else
+
+class OpenFile
+{
+public:
+	int fd_;
+
+	OpenFile(const char *path) : fd_(::open(path, O_RDONLY)) {}
+	~OpenFile() {
+		if(isOpen()) {
+			::close(fd_);
+		}
+	}
+	bool isOpen() const { return(fd_ >= 0); }
+
+	int64_t size() const {
+		struct stat st;
+		if(::fstat(fd_, &st) != 0) {
+			return(-1);
+		}
+		return((int64_t)st.st_size);
+	}
+	static int64_t viewAlignment() {
+		return(::sysconf(_SC_PAGESIZE));
+	}
+	void *mapView(int64_t offset, size_t size) {
+		// private writable pages are copy on write and never reach the file
+		void *view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, (off_t)offset);
+		return((view == MAP_FAILED) ? nullptr : view);
+	}
+};
+
+#endif
+
+ByteArray
+mapWindow(OpenFile &file, int64_t fileSize, int64_t offset, int length)
+{
+	if(offset < 0 || length < 0 || offset > fileSize) {
+		return(nullptr);
+	}
+	if(length > fileSize - offset) {
+		length = (int)(fileSize - offset);
+	}
+	if(length == 0) {
+		return(ByteArray(0));
+	}
+	// views must start on a page or allocation granularity boundary
+	int64_t viewOffset = offset - (offset % OpenFile::viewAlignment());
+	size_t lead = (size_t)(offset - viewOffset);
+	size_t viewSize = lead + (size_t)length;
+
+	void *view = file.mapView(viewOffset, viewSize);
+	if(!view) {
+		return(nullptr);
+	}
+	ObjectPtr<RcArrayObj<uint8_t>> hBytes = ObjectBase::make<MappedBytes>(length, (uint8_t *)view + lead, view, viewSize);
+	return(ByteArray(hBytes));
+}
+
+} // namespace
+
+ByteArray
+MappedFile::map(const char *path)
+{
+	OpenFile file(path);
+	if(!file.isOpen()) {
+		return(nullptr);
+	}
+	int64_t size = file.size();
+	if(size < 0 || size > INT_MAX) {
+		return(nullptr);
+	}
+	return(mapWindow(file, size, 0, (int)size));
+}
+
+ByteArray
+MappedFile::map(const char *path, int64_t offset, int length)
+{
+	OpenFile file(path);
+	if(!file.isOpen()) {
+		return(nullptr);
+	}
+	int64_t size = file.size();
+	if(size < 0) {
+		return(nullptr);
+	}
+	return(mapWindow(file, size, offset, length));
+}
+
+int64_t
+MappedFile::fileSize(const char *path)
+{
+	OpenFile file(path);
+	if(!file.isOpen()) {
+		return(-1);
+	}
+	return(file.size());
+}
+
+ARTD_END
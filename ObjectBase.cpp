@@ -27,6 +27,9 @@
 #include "artd/RcString.h"
 #include <set>
 #include <map>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 
 #include <iostream>
 
@@ -46,7 +49,7 @@ void ObjectBase::setKeepAllocatedRefs(bool on) {
 
 uint8_t ObjectBase::initValues[4] = { 0,1,2,3 };
 
-static size_t allocCount = 0;
+static std::atomic<size_t> allocCount(0);
 
 const char* ObjectBase::getCppClassName() const
 {
@@ -109,26 +112,38 @@ size_t ObjectBase::getAllocatedCount(bool final) {
 thread_local ObjAllocatorArg* _allocatorArg_ = nullptr;
 
 ObjectBase::~ObjectBase() {
-    remainingObjs.erase(this);
+    if (trackOutstanding) {
+        remainingObjs.erase(this);
+    }
     cbPtr = nullptr;
     --allocCount;
 }
 
 
+// malloc() and calloc() rather than operator new so zeroed blocks can come
+// from calloc() which gets large ones as fresh pages without touching them.
+static void* mallocOrThrow(size_t size, bool zeroed) {
+    void* p = zeroed ? ::calloc(1, size) : ::malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return(p);
+}
+
 void* ObjAllocatorArg::heapAllocate(size_t size) {
     ObjAllocatorArg* a = _allocatorArg_;
     if (a) {
         size += a->extraSize;
         a->allocatedSize = size;
    //     AD_LOG(info) << "allocating " << size << " bytes\n";
-        return(a->allocatedAt = ::operator new(size));
+        return(a->allocatedAt = mallocOrThrow(size, a->zeroed));
     }
 //    AD_LOG(info) << "allocating " << size << " bytes\n";
-    return(::operator new(size));
+    return(mallocOrThrow(size, false));
 }
 void ObjAllocatorArg::heapDeallocate(void* ptr) {
 //    AD_LOG(info) << "freeing obj @" << ((void*)ptr);
-    return(::operator delete(ptr));
+    ::free(ptr);
 }
 
 class ObjectBaseHolder {
@@ -210,7 +225,7 @@ void ObjectBaseHolder::poolDeallocate(void* ptr) {
 
 void ObjectBase::addRef() {
     
-    if (cbPtr == nullptr) {
+    if (cbPtr == nullptr || cbPtr == NOT_SHARED()) {
         return; // TODO: assert this is a shared object !!!
     }
     HackStdShared<ObjectBase> buf(this, cbPtr);
@@ -24,6 +24,7 @@
 
 //#include "artd/platform_specific.h"
 #include "artd/RcArray.h"
+#include "artd/StringAlgo.h"
 #include "stdlib.h"
 #include <string>
 
@@ -31,54 +32,172 @@
 
 ARTD_BEGIN
 
-RcArrayBase::RcArrayBase(int len)
-	: len_(len)
+RcArrayBase::RcArrayBase(int len, int alignment)
+	: data_((void *)ARTD_ALIGN_UP((uintptr_t)this + sizeof(*this), alignment))
+	, alignment_(alignment)
+	, len_(len)
+{
+}
+RcArrayBase::RcArrayBase(int len, void *externalData)
+	: data_(externalData)
+	, alignment_(0)
+	, len_(len)
 {
 }
 RcArrayBase::~RcArrayBase() {
 }
 
-#if 0
+// What the shared control block "owns", the array object is constructed over
+// it and this destroys the array object through its virtual destructor.
+class RcArrayHolder
+{
+	int placeholder_;
+public:
+	~RcArrayHolder() {
+		reinterpret_cast<RcArrayBase *>(this)->~RcArrayBase();
+	}
+	static void constructBase(void *mem, int numElems, int alignment) {
+		::new(mem) RcArrayBase(numElems, alignment);
+	}
+};
+
+// Allocator for the control block of arrays in blocks from an RcArrayBlockSource,
+// the copy std::allocate_shared keeps in the control block returns the block.
+template<class T>
+class BlockSourceAllocator
+{
+public:
+	typedef T value_type;
+
+	RcArrayBlockSource *source_;
+	size_t blockSize_;
+
+	template<typename U>
+	struct rebind { typedef BlockSourceAllocator<U> other; };
+
+	BlockSourceAllocator(RcArrayBlockSource *source, size_t blockSize)
+		: source_(source)
+		, blockSize_(blockSize)
+	{}
+	template<typename U>
+	BlockSourceAllocator(const BlockSourceAllocator<U> &other)
+		: source_(other.source_)
+		, blockSize_(other.blockSize_)
+	{}
+
+	T *allocate(size_t n) {
+		ObjAllocatorArg *a = ObjAllocatorArg::getArg();
+		size_t size = n * sizeof(T) + a->extraSize;
+		if(size > blockSize_) {
+			throw std::bad_alloc();
+		}
+		void *block = source_->takeBlock(blockSize_);
+		if(a->zeroed) {
+			::memset(block, 0, size);
+		}
+		a->allocatedSize = size;
+		return(static_cast<T *>(a->allocatedAt = block));
+	}
+	void deallocate(T *ptr, size_t /*n*/) {
+		source_->giveBlock(ptr, blockSize_);
+	}
+	template<typename U>
+	bool operator==(const BlockSourceAllocator<U> &b) const { return(source_ == b.source_); }
+	template<typename U>
+	bool operator!=(const BlockSourceAllocator<U> &b) const { return(source_ != b.source_); }
+};
+
+size_t
+RcArrayBase::blockSizeFor(int numElems, int elemsize, int alignment)
+{
+	size_t size = sizeForData((size_t)numElems * elemsize);
+	if(alignment > (int)sizeof(int)) {
+		size += alignment - sizeof(int);
+	}
+	// plus the shared control block with a copy of the allocator in it, the exact
+	// layout is private to the standard library so this is a generous bound
+	return(size + 8 * sizeof(void *));
+}
+
 ObjectPtr<RcArrayBase>
-RcArrayBase::allocate(int numElems, int elemsize, bool clear)
+RcArrayBase::allocateFrom(RcArrayBlockSource *source, size_t blockSize,
+                          int numElems, int elemsize, bool clearIt, int alignment)
 {
-	size_t size = sizeForData(numElems * elemsize);
-	return(nullptr);
+	size_t size = sizeForData((size_t)numElems * elemsize);
+	if(alignment > (int)sizeof(int)) {
+		size += alignment - sizeof(int);
+	}
+	ObjAllocatorArg allocArg(size - sizeof(RcArrayHolder), clearIt);
+	std::shared_ptr<RcArrayHolder> sptr = std::allocate_shared<RcArrayHolder>(BlockSourceAllocator<RcArrayHolder>(source, blockSize));
+
+	RcArrayHolder::constructBase(sptr.get(), numElems, alignment);
+
+	return(*reinterpret_cast<ObjectPtr<RcArrayBase>*>((void*)&sptr));
 }
-#endif
 
 ObjectPtr<RcArrayBase>
-RcArrayBase::allocate(int numElems, int elemsize)
+RcArrayBase::allocateAs(int numElems, int elemsize, bool clearIt, int alignment, ConstructFunc construct)
 {
-	size_t size = sizeForData(numElems * elemsize);
+	size_t size = sizeForData((size_t)numElems * elemsize);
+	// the object and its tail are at least int aligned, more needs padding
+	if(alignment > (int)sizeof(int)) {
+		size += alignment - sizeof(int);
+	}
 
-	ObjAllocatorArg allocArg(size - sizeof(int));
-	std::shared_ptr<int> sptr = std::allocate_shared<int>(ObjectAllocator<int>());
+	ObjAllocatorArg allocArg(size - sizeof(RcArrayHolder), clearIt);
+	std::shared_ptr<RcArrayHolder> sptr = std::allocate_shared<RcArrayHolder>(ObjectAllocator<RcArrayHolder>());
 
-	void* me = sptr.get();
-	RcArrayBase* obj = ::new(me) RcArrayBase(numElems);
+	construct(sptr.get(), numElems, alignment);
 
 	return(*reinterpret_cast<ObjectPtr<RcArrayBase>*>((void*)&sptr));
 }
 
-#if 0
+ObjectPtr<RcArrayBase>
+RcArrayBase::allocate(int numElems, int elemsize, bool clearIt, int alignment)
+{
+	return(allocateAs(numElems, elemsize, clearIt, alignment, &RcArrayHolder::constructBase));
+}
 
-int
-RcArrayOwnedObjectBase::equals(const RcArrayOwnedObjectBase *a, const RcArrayOwnedObjectBase *b)
+bool
+RcArrayBase::equals(const RcArrayBase *a, const RcArrayBase *b, int elemSize)
 {
-	if(!a || !b) {
-		return(false);
+	if(a == b) {
+		return(true);
 	}
-	if(a->len_ != b->len_) {
+	if(!a || !b || a->len_ != b->len_) {
 		return(false);
 	}
-	if(a == b) {
+	if(a->data_ == b->data_) {
 		return(true);
 	}
-	return(::memcmp(a->data(),b->data(),b->len_) == 0);
+	return(::memcmp(a->data_, b->data_, (size_t)a->len_ * elemSize) == 0);
+}
+
+int
+RcArrayBase::compareBytes(const RcArrayBase *a, const RcArrayBase *b)
+{
+	if(a == b) {
+		return(0);
+	}
+	if(!a || !b) {
+		return(a ? 1 : -1);
+	}
+	const int len = (a->len_ < b->len_) ? a->len_ : b->len_;
+	int ret = ::memcmp(a->data_, b->data_, len);
+	if(ret != 0) {
+		return(ret);
+	}
+	return(a->len_ - b->len_);
 }
 
-#endif // 0
+uint32_t
+RcArrayBase::hashBytes(const RcArrayBase *a, int elemSize)
+{
+	if(!a) {
+		return(0);
+	}
+	return(StringAlgo::hash((const char *)a->data_, a->len_ * elemSize));
+}
 
 ARTD_END
 
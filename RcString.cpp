@@ -1,36 +1,14 @@
 #include "artd/RcString.h"
 #include "artd/Formatf.h"
+#include "artd/utf8util.h"
+#include "artd/RcStringStats.h"
 
 ARTD_BEGIN
 
-template<>
-RcStrBaseT<RcString, char>::super RcStrBaseT<RcString, char>::create(const wchar_t* from) {
-	RcString str = format("%w", from);
-	return(*reinterpret_cast<super*>(&str));
-}
-
-template<>
-RcStrBaseT<RcString, char> RcStrBaseT<RcString, char>::create(const RcWString& s) {
-
-	RcString str = format("%w", s->chars());
-	return(*reinterpret_cast<RcStrBaseT<RcString, char>*>(&str));
-}
-
-template<>
-RcStrBaseT<RcWString, wchar_t> RcStrBaseT<RcWString, wchar_t>::create(const RcString& s) {
-	RcWString str = format("%s", s->chars());
-	return(*reinterpret_cast<RcStrBaseT<RcWString, wchar_t>*>(&str));
-}
-
-
-RcString::RcString(const RcWString& str) : super(super::create(str)) {}
-
-RcWString::RcWString(const RcString &str) : super(super::create(str)) {}
-
-
 template<class ChT>
 inline string_object<ChT>::string_object(int len)
 	: len_(len)
+	, hash_(0)
 {
 #ifdef ENABLE_RCSTRING_VIEW
     const char* dis = (const char*)this;
@@ -53,63 +31,96 @@ public:
 	{}
 };
 
+// handle to a string object, static strings get a handle with no control block
+template<class StrT, class ChT>
+static StrT handleTo(string_object<ChT>* obj, ObjectPtr<string_object<ChT>>&& ref) {
+	if (!ref) {
+		HackStdShared<string_object<ChT>> self(obj, nullptr);
+		return(*reinterpret_cast<StrT*>(&self.objPtr()));
+	}
+	return(*reinterpret_cast<StrT*>(&ref));
+}
+
 template<>
 RcString string_object<char>::toString() {
-	return(RcString("wstr not done"));
+	return(handleTo<RcString>(this, makeReferencingHandle(this)));
 }
 
 template<>
 RcString string_object<wchar_t>::toString() {
-	return(RcString("wstr not done"));
+	return(RcString(handleTo<RcWString>(this, makeReferencingHandle(this))));
+}
+
+// allocates a string object for sLen chars plus the null, the chars are not initialized
+template<class StrT>
+static StrT allocateChars(int sLen) {
+
+	typedef typename StrT::ObjT ObjT;
+	ObjAllocatorArg allocArg(ObjT::sizeForChars(sLen) - sizeof(ObjT));
+	std::shared_ptr<typename ObjT::Impl> sptr = std::allocate_shared<typename ObjT::Impl>(ObjectAllocator<typename ObjT::Impl>(), (int)sLen);
+	return(*reinterpret_cast<StrT*>((void*)&sptr));
 }
 
 template<>
 RcString RcStrBaseT<RcString, char>::createForSize(int sLen) {
 
-	ObjAllocatorArg allocArg(ObjT::sizeForChars(sLen) - sizeof(ObjT));
-	std::shared_ptr<ObjT::Impl> sptr = std::allocate_shared<ObjT::Impl>(ObjectAllocator<ObjT::Impl>(), (int)sLen);
-	return(*reinterpret_cast<RcString*>((void*)&sptr));
+	RcStringStats::onAllocate(sLen, sizeof(CharT), nullptr);
+	return(allocateChars<RcString>(sLen));
 }
 
 template<>
-RcStrBaseT<RcString, char>::super RcStrBaseT<RcString, char>::create(const char* from) {
+RcString RcStrBaseT<RcString, char>::createForSize(int sLen, const char* initialValue) {
 
-	const int sLen = (int)::strlen(from);
-	RcString str = createForSize(sLen);
+	RcStringStats::onAllocate(sLen, sizeof(CharT), initialValue);
+	RcString str = allocateChars<RcString>(sLen);
 	CharT* pout = str->chars();
+	::memcpy(pout, initialValue, sLen * sizeof(CharT));
+	pout[sLen] = 0;
+	return(str);
+}
 
-	const CharT* pin = from;
-	const CharT* const pmax = pout + sLen; // obj->length();
-	while (pout < pmax) {
-		*pout++ = *pin++;
-	}
-	*pout = 0;
+template<>
+RcStrBaseT<RcString, char>::super RcStrBaseT<RcString, char>::create(const char* from) {
+
+	RcString str = createForSize((int)::strlen(from), from);
 	return(*reinterpret_cast<super*>(&str));
 }
 
-template<>
-RcString RcStrBaseT<RcString, char>::vformat(const char* fmt, const FormatfArglist<>& args) {
+// Formats into a stack buffer, big enough for most results, so the format
+// runs once and the string is allocated at its exact size. Results that don't
+// fit fall back to measuring then formatting into the new string.
+static const int FormatScratchBytes = 512;
+
+template<class StrT, class FmtT>
+static StrT formatToString(const FmtT* fmt, const FormatfArglist<>& args) {
+
+	typedef typename StrT::CharT CharT;
+	CharT scratch[FormatScratchBytes / sizeof(CharT)];
+	CharT probe[8];
 
 	FormatfStream fa;
-	int sLen = fa.vlenf(fmt, args);
+	fa.va_init(fmt, args);
+	int bytes = fa.read(scratch, (int)sizeof(scratch));
+	if (fa.read(probe, (int)sizeof(probe)) <= 0) {
+		return(StrT::createForSize(bytes > 0 ? bytes / (int)sizeof(CharT) : 0, scratch));
+	}
+	fa.va_init(fmt, args);
+	const int sLen = (sizeof(CharT) == sizeof(char)) ? fa.sizef() : fa.lenf();
 	fa.va_init(fmt, args);
 
-	RcString str = createForSize(sLen);
-	char* pchars = str->chars();
-	fa.sprintf(pchars, sLen + 1);
+	StrT str = StrT::createForSize(sLen);
+	fa.sprintf(str->chars(), sLen + 1);
 	return(str);
 }
 
 template<>
-RcString RcStrBaseT<RcString, char>::vformat(const wchar_t* fmt, const FormatfArglist<>& args) {
-	FormatfStream fa;
-	int sLen = fa.vlenf(fmt, args);
-	fa.va_init(fmt, args);
+RcString RcStrBaseT<RcString, char>::vformat(const char* fmt, const FormatfArglist<>& args) {
+	return(formatToString<RcString>(fmt, args));
+}
 
-	RcString str = createForSize(sLen);
-	char* pchars = str->chars();
-	fa.sprintf(pchars, sLen + 1);
-	return(str);
+template<>
+RcString RcStrBaseT<RcString, char>::vformat(const wchar_t* fmt, const FormatfArglist<>& args) {
+	return(formatToString<RcString>(fmt, args));
 }
 
 // ********* WString
@@ -117,57 +128,94 @@ RcString RcStrBaseT<RcString, char>::vformat(const wchar_t* fmt, const FormatfAr
 template<>
 RcWString RcStrBaseT<RcWString, wchar_t>::createForSize(int sLen) {
 
-	ObjAllocatorArg allocArg(ObjT::sizeForChars(sLen) - sizeof(ObjT));
-	std::shared_ptr<ObjT::Impl> sptr = std::allocate_shared<ObjT::Impl>(ObjectAllocator<ObjT::Impl>(), (int)sLen);
-	return(*reinterpret_cast<RcWString*>((void*)&sptr));
+	RcStringStats::onAllocate(sLen, sizeof(CharT), nullptr);
+	return(allocateChars<RcWString>(sLen));
 }
 
 template<>
-RcStrBaseT<RcWString, wchar_t>::super RcStrBaseT<RcWString, wchar_t>::create(const wchar_t* from) {
-
-	const int sLen = (int)::wcslen(from);
+RcWString RcStrBaseT<RcWString, wchar_t>::createForSize(int sLen, const wchar_t* initialValue) {
 
-	RcWString str = createForSize(sLen);
+	RcStringStats::onAllocate(sLen, sizeof(CharT), initialValue);
+	RcWString str = allocateChars<RcWString>(sLen);
 	CharT* pout = str->chars();
+	::memcpy(pout, initialValue, sLen * sizeof(CharT));
+	pout[sLen] = 0;
+	return(str);
+}
 
-	const CharT* pin = from;
-	const CharT* const pmax = pout + sLen; // obj->length();
-	while (pout < pmax) {
-		*pout++ = *pin++;
-	}
-	*pout = 0;
+template<>
+RcStrBaseT<RcWString, wchar_t>::super RcStrBaseT<RcWString, wchar_t>::create(const wchar_t* from) {
+
+	RcWString str = createForSize((int)::wcslen(from), from);
 	return(*reinterpret_cast<super*>(&str));
 }
 
 template<>
 RcWString RcStrBaseT<RcWString, wchar_t>::vformat(const char* fmt, const FormatfArglist<>& args) {
+	return(formatToString<RcWString>(fmt, args));
+}
+
+template<>
+RcWString RcStrBaseT<RcWString, wchar_t>::vformat(const wchar_t* fmt, const FormatfArglist<>& args) {
+	return(formatToString<RcWString>(fmt, args));
+}
 
-	FormatfStream fa;
-	int sLen = fa.vlenf(fmt, args);
-	fa.va_init(fmt, args);
 
-	RcWString str = createForSize(sLen);
-	wchar_t* pchars = str->chars();
-	fa.sprintf(pchars, sLen + 1);
+// utf8 <-> wchar_t conversions size the result exactly then encode straight into it
+
+static RcString utf8FromWide(const wchar_t* from, int len) {
+	const int sLen = Utf8::encodedSize(from, len);
+	RcString str = RcString::createForSize(sLen);
+	char* pout = Utf8::encodeTo(str->chars(), from, len);
+	*pout = 0;
+	return(str);
+}
+
+static RcWString wideFromUtf8(const char* from, int len) {
+	const int sLen = Utf8::decodedLength(from, len);
+	RcWString str = RcWString::createForSize(sLen);
+	wchar_t* pout = Utf8::decodeTo(str->chars(), from, len);
+	*pout = 0;
 	return(str);
 }
 
 template<>
-RcWString RcStrBaseT<RcWString, wchar_t>::vformat(const wchar_t* fmt, const FormatfArglist<>& args) {
-	FormatfStream fa;
-	int sLen = fa.vlenf(fmt, args);
-	fa.va_init(fmt, args);
+RcStrBaseT<RcString, char>::super RcStrBaseT<RcString, char>::create(const wchar_t* from) {
+	if (!from) {
+		return(super());
+	}
+	RcString str = utf8FromWide(from, (int)::wcslen(from));
+	return(*reinterpret_cast<super*>(&str));
+}
 
-	RcWString str = createForSize(sLen);
-	wchar_t* pchars = str->chars();
-	fa.sprintf(pchars, sLen + 1);
-	return(str);
+template<>
+RcStrBaseT<RcString, char> RcStrBaseT<RcString, char>::create(const RcWString& s) {
+	if (!s) {
+		return(RcStrBaseT<RcString, char>());
+	}
+	RcString str = utf8FromWide(s.c_str(), s.length());
+	return(*reinterpret_cast<RcStrBaseT<RcString, char>*>(&str));
+}
+
+template<>
+RcStrBaseT<RcWString, wchar_t> RcStrBaseT<RcWString, wchar_t>::create(const RcString& s) {
+	if (!s) {
+		return(RcStrBaseT<RcWString, wchar_t>());
+	}
+	RcWString str = wideFromUtf8(s.c_str(), s.length());
+	return(*reinterpret_cast<RcStrBaseT<RcWString, wchar_t>*>(&str));
 }
 
+RcString::RcString(const RcWString& str) : super(super::create(str)) {}
+
+RcWString::RcWString(const RcString &str) : super(super::create(str)) {}
 
 template<>
 RcStrBaseT<RcWString, wchar_t>::super RcStrBaseT<RcWString, wchar_t>::create(const char* from) {
-	RcWString str = format("%s", from);
+	if (!from) {
+		return(super());
+	}
+	RcWString str = wideFromUtf8(from, (int)::strlen(from));
 	return(*reinterpret_cast<super*>(&str));
 }
 
@@ -508,51 +556,6 @@ template class XStringTptrT<RcString, char>;
 template class XStringTptrT<RcWString, wchar_t>;
 #endif
 
-template<>
-bool
-RcStrBaseT<RcWString,wchar_t>::equals(const WStringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::wcscmp(sp, p_->chars())) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
-template<>
-bool
-RcStrBaseT<RcWString,wchar_t>::equalsIgnoreCase(const WStringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::_wcsicmp(sp, p_->chars())) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
-template<>
-bool
-RcStrBaseT<RcWString,wchar_t>::startsWith(const WStringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::wcsncmp(sp, p_->chars(), ::wcslen(sp))) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
 /*
 int
 RcWString::getBytes(int8_t *buf, int maxlen) const
@@ -627,72 +630,8 @@ copyIt:
 */
 
 
-template<>
-bool
-RcStrBaseT<RcString,char>::equals(const StringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::strcmp(sp, p_->chars())) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
-template<>
-bool
-RcStrBaseT<RcString,char>::equalsIgnoreCase(const StringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::_stricmp(sp, p_->chars())) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
-template<>
-bool
-RcStrBaseT<RcString,char>::startsWith(const StringArg &sp) const
-{
-	if(!sp || !p_) {
-		goto notequal;
-	}
-	if(::strncmp(sp, p_->chars(), ::strlen(sp))) {
-		goto notequal;
-	}
-	return(true);
-notequal:
-	return(false);
-}
-
-
-template<class SubT, class ChT>
-int 
-RcStrBaseT<SubT,ChT>::lastIndexOf(unsigned int ch) const
-{ 
-#ifdef _MSC_VER
-	const ChT *pc = p_->chars();
-	int i = p_->length();
-#else // __GNUC__
-	const ChT *pc = super::p_->chars();
-	int i = super::p_->length();
-#endif
-
-	while(--i >= 0)
-	{
-		if(pc[i] == ch) {
-			break;
-		}
-	}
-	return(i);
-}
+// equals(), equalsIgnoreCase(), startsWith() and lastIndexOf() are now
+// inline in RcStrBaseT using StringAlgo
 
 // instantiate here ??
 
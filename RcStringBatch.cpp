@@ -0,0 +1,228 @@
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/RcStringBatch.h"
+#include "artd/StringAlgo.h"
+#include "artd/utf8util.h"
+#include <exception>
+#include <thread>
+#include <vector>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+namespace {
+
+// below this many strings per thread the thread startup costs more than it saves
+static const int MinStringsPerThread = 4096;
+
+template<class FuncT>
+void forRanges(int count, int threads, FuncT fn) {
+
+	if(threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	int maxThreads = count / MinStringsPerThread;
+	if(threads > maxThreads) {
+		threads = maxThreads;
+	}
+	if(threads <= 1) {
+		fn(0, count);
+		return;
+	}
+	const int perThread = (count + threads - 1) / threads;
+
+	// an exception in a range is kept until all the threads are joined, then
+	// the first one is rethrown
+	std::vector<std::exception_ptr> errors(threads);
+	auto runRange = [&fn, &errors](int ix, int start, int end) {
+		try {
+			fn(start, end);
+		} catch(...) {
+			errors[ix] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> workers;
+	try {
+		workers.reserve(threads - 1);
+		int ix = 1;
+		for(int start = perThread; start < count; start += perThread) {
+			int end = (count - start > perThread) ? start + perThread : count;
+			workers.emplace_back(runRange, ix++, start, end);
+		}
+	} catch(...) {
+		errors[0] = std::current_exception(); // a thread failed to start
+	}
+	if(!errors[0]) {
+		runRange(0, 0, perThread); // this thread does the first range
+	}
+	for(auto &w : workers) {
+		w.join();
+	}
+	for(auto &e : errors) {
+		if(e) {
+			std::rethrow_exception(e);
+		}
+	}
+}
+
+// uniform access to the chars of the input types
+
+INL bool isNull(const RcString &s) { return(!s); }
+INL bool isNull(const RcWString &s) { return(!s); }
+INL bool isNull(const StringArg &s) { return(s.c_str() == nullptr); }
+INL bool isNull(const WStringArg &s) { return(s.c_str() == nullptr); }
+
+INL const char *chars(const RcString &s) { return(s.c_str()); }
+INL const wchar_t *chars(const RcWString &s) { return(s.c_str()); }
+INL const char *chars(const StringArg &s) { return(s.c_str()); }
+INL const wchar_t *chars(const WStringArg &s) { return(s.c_str()); }
+
+INL int lengthOf(const RcString &s) { return(s.length()); }
+INL int lengthOf(const RcWString &s) { return(s.length()); }
+INL int lengthOf(const StringArg &s) { return(s.length()); }
+INL int lengthOf(const WStringArg &s) { return(s.length()); }
+
+template<class InT>
+void hashRange(const InT *in, uint32_t *out, int start, int end) {
+	for(int i = start; i < end; ++i) {
+		out[i] = isNull(in[i]) ? StringAlgo::hash("", 0) : StringAlgo::hash(chars(in[i]), lengthOf(in[i]));
+	}
+}
+
+void hashRange(const RcString *in, uint32_t *out, int start, int end) {
+	for(int i = start; i < end; ++i) {
+		out[i] = in[i] ? in[i].hashCode() : StringAlgo::hash("", 0);
+	}
+}
+
+template<class InT>
+void caseRange(const InT *in, RcString *out, int start, int end, bool upper) {
+	for(int i = start; i < end; ++i) {
+		if(isNull(in[i])) {
+			out[i] = nullptr;
+			continue;
+		}
+		const int len = lengthOf(in[i]);
+		RcString s = RcString::createForSize(len);
+		char *pout = s->chars();
+		if(upper) {
+			StringAlgo::toUpper(pout, chars(in[i]), len);
+		} else {
+			StringAlgo::toLower(pout, chars(in[i]), len);
+		}
+		pout[len] = 0;
+		out[i] = std::move(s);
+	}
+}
+
+template<class InT>
+void utf8Range(const InT *in, RcString *out, int start, int end) {
+	for(int i = start; i < end; ++i) {
+		if(isNull(in[i])) {
+			out[i] = nullptr;
+			continue;
+		}
+		const wchar_t *src = chars(in[i]);
+		const int len = lengthOf(in[i]);
+		RcString s = RcString::createForSize(Utf8::encodedSize(src, len));
+		*Utf8::encodeTo(s->chars(), src, len) = 0;
+		out[i] = std::move(s);
+	}
+}
+
+template<class InT>
+void wideRange(const InT *in, RcWString *out, int start, int end) {
+	for(int i = start; i < end; ++i) {
+		if(isNull(in[i])) {
+			out[i] = nullptr;
+			continue;
+		}
+		const char *src = chars(in[i]);
+		const int len = lengthOf(in[i]);
+		RcWString s = RcWString::createForSize(Utf8::decodedLength(src, len));
+		*Utf8::decodeTo(s->chars(), src, len) = 0;
+		out[i] = std::move(s);
+	}
+}
+
+} // namespace
+
+#undef INL
+
+void
+RcStringBatch::hash(const RcString *in, int count, uint32_t *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { hashRange(in, out, start, end); });
+}
+void
+RcStringBatch::hash(const StringArg *in, int count, uint32_t *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { hashRange(in, out, start, end); });
+}
+
+void
+RcStringBatch::toLower(const RcString *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { caseRange(in, out, start, end, false); });
+}
+void
+RcStringBatch::toLower(const StringArg *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { caseRange(in, out, start, end, false); });
+}
+void
+RcStringBatch::toUpper(const RcString *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { caseRange(in, out, start, end, true); });
+}
+void
+RcStringBatch::toUpper(const StringArg *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { caseRange(in, out, start, end, true); });
+}
+
+void
+RcStringBatch::toUtf8(const RcWString *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { utf8Range(in, out, start, end); });
+}
+void
+RcStringBatch::toUtf8(const WStringArg *in, int count, RcString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { utf8Range(in, out, start, end); });
+}
+void
+RcStringBatch::toWide(const RcString *in, int count, RcWString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { wideRange(in, out, start, end); });
+}
+void
+RcStringBatch::toWide(const StringArg *in, int count, RcWString *out, int threads)
+{
+	forRanges(count, threads, [=](int start, int end) { wideRange(in, out, start, end); });
+}
+
+ARTD_END
@@ -0,0 +1,244 @@
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/RcStringStats.h"
+#include "artd/RcString.h"
+#include "artd/StringAlgo.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+ARTD_BEGIN
+
+std::atomic<int> RcStringStats::sampleEvery_(0);
+
+namespace {
+
+// histogram bucket 0 is empty strings, bucket n holds lengths [2^(n-1), 2^n)
+static const int NumBuckets = 26;
+// bounds the memory used by the fingerprint table
+static const size_t MaxDistinct = 1 << 16;
+static const int PreviewChars = 40;
+
+struct Dup
+{
+	int64_t count;
+	int64_t bytes;
+	std::string preview;
+};
+
+struct Stats
+{
+	std::mutex lock;
+	std::atomic<uint32_t> ticks;
+	int64_t sampled;
+	int64_t sampledBytes;
+	int64_t small;
+	int64_t smallBytes;
+	int64_t fingerprinted;
+	int64_t untracked;
+	int64_t buckets[NumBuckets];
+	int64_t bucketBytes[NumBuckets];
+	std::unordered_map<uint64_t, Dup> dups;
+
+	Stats() : ticks(0) {
+		clear();
+	}
+	void clear() {
+		sampled = sampledBytes = small = smallBytes = fingerprinted = untracked = 0;
+		std::fill(buckets, buckets + NumBuckets, 0);
+		std::fill(bucketBytes, bucketBytes + NumBuckets, 0);
+		dups.clear();
+	}
+};
+
+Stats &stats() {
+	static Stats s;
+	return(s);
+}
+
+// set while recording or reporting so strings made here are not sampled
+thread_local bool inStats = false;
+
+int bucketFor(int len) {
+	int b = 0;
+	while(len > 0 && b < NumBuckets - 1) {
+		len >>= 1;
+		++b;
+	}
+	return(b);
+}
+
+std::string previewOf(const void *chars, int count, int charSize) {
+	std::string out;
+	int n = std::min(count, PreviewChars);
+	out.reserve(n + 3);
+	for(int i = 0; i < n; ++i) {
+		int c = (charSize == 1) ? ((const uint8_t *)chars)[i] : (int)((const wchar_t *)chars)[i];
+		// keep the report on one line and plain ascii
+		out += (c >= ' ' && c < 0x7F && c != '"') ? (char)c : '.';
+	}
+	if(n < count) {
+		out += "...";
+	}
+	return(out);
+}
+
+} // namespace
+
+void
+RcStringStats::enable(int sampleEvery)
+{
+	sampleEvery_.store(sampleEvery < 1 ? 1 : sampleEvery, std::memory_order_relaxed);
+}
+
+void
+RcStringStats::disable()
+{
+	sampleEvery_.store(0, std::memory_order_relaxed);
+}
+
+void
+RcStringStats::reset()
+{
+	Stats &st = stats();
+	std::lock_guard<std::mutex> guard(st.lock);
+	st.clear();
+}
+
+void
+RcStringStats::sample(int charCount, int charSize, const void *chars)
+{
+	if(inStats) {
+		return;
+	}
+	Stats &st = stats();
+	int every = sampleEvery_.load(std::memory_order_relaxed);
+	if(every > 1 && (st.ticks.fetch_add(1, std::memory_order_relaxed) % (uint32_t)every) != 0) {
+		return;
+	}
+	inStats = true;
+
+	const int64_t bytes = (int64_t)(charCount + 1) * charSize;
+	uint64_t print = 0;
+	if(chars) {
+		// length in the high word so colliding hashes also need equal lengths
+		print = ((uint64_t)(uint32_t)charCount << 32)
+				| StringAlgo::hash((const char *)chars, charCount * charSize);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(st.lock);
+
+		++st.sampled;
+		st.sampledBytes += bytes;
+		if(bytes <= SmallStringBytes) {
+			++st.small;
+			st.smallBytes += bytes;
+		}
+		int b = bucketFor(charCount);
+		++st.buckets[b];
+		st.bucketBytes[b] += bytes;
+
+		if(chars) {
+			++st.fingerprinted;
+			auto found = st.dups.find(print);
+			if(found != st.dups.end()) {
+				++found->second.count;
+				found->second.bytes += bytes;
+			} else if(st.dups.size() < MaxDistinct) {
+				st.dups.emplace(print, Dup{ 1, bytes, previewOf(chars, charCount, charSize) });
+			} else {
+				++st.untracked;
+			}
+		}
+	}
+	inStats = false;
+}
+
+RcString
+RcStringStats::report(int topN)
+{
+	Stats &st = stats();
+	inStats = true;
+
+	std::string out;
+	std::vector<const Dup *> top;
+	{
+		std::lock_guard<std::mutex> guard(st.lock);
+
+		int every = sampleEvery_.load(std::memory_order_relaxed);
+		out += RcString::format("RcString stats: %lld strings %lld bytes sampled, 1 in %d\n",
+								st.sampled, st.sampledBytes, every < 1 ? 1 : every).c_str();
+
+		out += "length histogram:\n";
+		for(int b = 0; b < NumBuckets; ++b) {
+			if(st.buckets[b] == 0) {
+				continue;
+			}
+			int lo = (b == 0) ? 0 : (1 << (b - 1));
+			int hi = (b == 0) ? 0 : (b == NumBuckets - 1) ? 0x7FFFFFFF : (1 << b) - 1;
+			out += RcString::format("  %8d - %-10d %10lld strings %12lld bytes\n",
+									lo, hi, st.buckets[b], st.bucketBytes[b]).c_str();
+		}
+		out += RcString::format("%lld strings %lld bytes would fit in a %d byte small string buffer\n",
+								st.small, st.smallBytes, (int)SmallStringBytes).c_str();
+
+		for(auto &entry : st.dups) {
+			if(entry.second.count > 1) {
+				top.push_back(&entry.second);
+			}
+		}
+		size_t n = std::min(top.size(), (size_t)(topN < 0 ? 0 : topN));
+		// rank by the bytes interning would save
+		std::partial_sort(top.begin(), top.begin() + n, top.end(),
+			[](const Dup *a, const Dup *b) {
+				return(a->bytes - a->bytes / a->count > b->bytes - b->bytes / b->count);
+			});
+
+		int64_t dupBytes = 0;
+		for(const Dup *d : top) {
+			dupBytes += d->bytes - d->bytes / d->count;
+		}
+		out += RcString::format("%lld strings fingerprinted, %lld duplicated values, %lld bytes in duplicates\n",
+								st.fingerprinted, (int64_t)top.size(), dupBytes).c_str();
+		if(st.untracked) {
+			out += RcString::format("%lld strings not fingerprinted, table full\n", st.untracked).c_str();
+		}
+		if(n > 0) {
+			out += "top duplicated values:\n";
+		}
+		for(size_t i = 0; i < n; ++i) {
+			const Dup *d = top[i];
+			out += RcString::format("  %8lld copies %12lld bytes \"%s\"\n",
+									d->count, d->bytes, d->preview.c_str()).c_str();
+		}
+	}
+	inStats = false;
+	return(RcString::createForSize((int)out.size(), out.c_str()));
+}
+
+ARTD_END
@@ -0,0 +1,657 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/StringAlgo.h"
+#include <atomic>
+#include <string.h>
+#include <wchar.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define ARTD_STRALGO_X86 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+#if defined(__GNUC__)
+	#define ARTD_TARGET_AVX2 __attribute__((target("avx2")))
+	#define ARTD_CTZ(x) __builtin_ctz(x)
+	#define ARTD_CLZ(x) __builtin_clz(x)
+#elif defined(_MSC_VER)
+	#define ARTD_TARGET_AVX2
+	static inline int ARTD_CTZ(unsigned int x) { unsigned long ix; _BitScanForward(&ix, x); return((int)ix); }
+	static inline int ARTD_CLZ(unsigned int x) { unsigned long ix; _BitScanReverse(&ix, x); return(31 - (int)ix); }
+#endif
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+namespace {
+
+// one set of these is selected the first time any of them is called.
+struct StrKernels
+{
+	const char *name;
+	int  (*indexOfChar)(const char *s, int len, int ch);
+	int  (*lastIndexOfChar)(const char *s, int len, int ch);
+	int  (*indexOfSub)(const char *s, int len, const char *sub, int subLen);
+	int  (*mismatchIgnoreCase)(const char *a, const char *b, int len);
+	void (*caseFold)(char *out, const char *in, int len, bool toUpper);
+};
+
+// ********* scalar kernels
+
+int scalarIndexOfChar(const char *s, int len, int ch)
+{
+	const char *p = (const char *)::memchr(s, ch, len);
+	return(p ? (int)(p - s) : -1);
+}
+
+int scalarLastIndexOfChar(const char *s, int len, int ch)
+{
+	while(--len >= 0) {
+		if(s[len] == (char)ch) {
+			break;
+		}
+	}
+	return(len);
+}
+
+int scalarIndexOfSub(const char *s, int len, const char *sub, int subLen)
+{
+	// subLen is >= 2 and <= len here
+	const char *p = s;
+	const char *pmax = s + (len - subLen);
+	const char first = sub[0];
+	while(p <= pmax) {
+		p = (const char *)::memchr(p, first, (pmax - p) + 1);
+		if(!p) {
+			break;
+		}
+		if(::memcmp(p + 1, sub + 1, subLen - 1) == 0) {
+			return((int)(p - s));
+		}
+		++p;
+	}
+	return(-1);
+}
+
+int scalarMismatchIgnoreCase(const char *a, const char *b, int len)
+{
+	for(int i = 0; i < len; ++i) {
+		if(a[i] != b[i] && StringAlgo::toLowerAscii((unsigned char)a[i]) != StringAlgo::toLowerAscii((unsigned char)b[i])) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+void scalarCaseFold(char *out, const char *in, int len, bool toUpper)
+{
+	const char *max = in + len;
+	if(toUpper) {
+		while(in < max) {
+			*out++ = (char)StringAlgo::toUpperAscii((unsigned char)*in++);
+		}
+	} else {
+		while(in < max) {
+			*out++ = (char)StringAlgo::toLowerAscii((unsigned char)*in++);
+		}
+	}
+}
+
+const StrKernels scalarKernels = {
+	"scalar",
+	scalarIndexOfChar,
+	scalarLastIndexOfChar,
+	scalarIndexOfSub,
+	scalarMismatchIgnoreCase,
+	scalarCaseFold
+};
+
+#ifdef ARTD_STRALGO_X86
+
+// ********* SSE2 kernels, SSE2 is always present on x86_64
+
+// lower cases A-Z in 16 chars, 'A' is biased to -128 so a single signed compare finds the range
+INL __m128i sse2FoldLower(__m128i v)
+{
+	const __m128i biased = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+	const __m128i isUpper = _mm_cmplt_epi8(biased, _mm_set1_epi8((char)(-128 + 26)));
+	return(_mm_or_si128(v, _mm_and_si128(isUpper, _mm_set1_epi8(0x20))));
+}
+
+INL __m128i sse2FoldUpper(__m128i v)
+{
+	const __m128i biased = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'a')));
+	const __m128i isLower = _mm_cmplt_epi8(biased, _mm_set1_epi8((char)(-128 + 26)));
+	return(_mm_andnot_si128(_mm_and_si128(isLower, _mm_set1_epi8(0x20)), v));
+}
+
+int sse2IndexOfChar(const char *s, int len, int ch)
+{
+	const __m128i needle = _mm_set1_epi8((char)ch);
+	int i = 0;
+	for(; i + 16 <= len; i += 16) {
+		unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s + i)), needle));
+		if(mask) {
+			return(i + ARTD_CTZ(mask));
+		}
+	}
+	int ret = scalarIndexOfChar(s + i, len - i, ch);
+	return(ret < 0 ? ret : i + ret);
+}
+
+int sse2LastIndexOfChar(const char *s, int len, int ch)
+{
+	const __m128i needle = _mm_set1_epi8((char)ch);
+	int i = len;
+	for(; i >= 16; i -= 16) {
+		unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s + i - 16)), needle));
+		if(mask) {
+			return(i - 16 + (31 - ARTD_CLZ(mask)));
+		}
+	}
+	return(scalarLastIndexOfChar(s, i, ch));
+}
+
+// first and last char of the substring are compared in parallel at 16 positions,
+// only candidates matching both are then checked with memcmp.
+int sse2IndexOfSub(const char *s, int len, const char *sub, int subLen)
+{
+	const __m128i first = _mm_set1_epi8(sub[0]);
+	const __m128i last = _mm_set1_epi8(sub[subLen - 1]);
+	int i = 0;
+	for(; i + 16 + subLen - 1 <= len; i += 16) {
+		const __m128i blockFirst = _mm_loadu_si128((const __m128i *)(s + i));
+		const __m128i blockLast = _mm_loadu_si128((const __m128i *)(s + i + subLen - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+		while(mask) {
+			const int bit = ARTD_CTZ(mask);
+			if(::memcmp(s + i + bit + 1, sub + 1, subLen - 2) == 0) {
+				return(i + bit);
+			}
+			mask &= mask - 1;
+		}
+	}
+	if(len - i < subLen) {
+		return(-1);
+	}
+	int ret = scalarIndexOfSub(s + i, len - i, sub, subLen);
+	return(ret < 0 ? ret : i + ret);
+}
+
+int sse2MismatchIgnoreCase(const char *a, const char *b, int len)
+{
+	int i = 0;
+	for(; i + 16 <= len; i += 16) {
+		const __m128i va = sse2FoldLower(_mm_loadu_si128((const __m128i *)(a + i)));
+		const __m128i vb = sse2FoldLower(_mm_loadu_si128((const __m128i *)(b + i)));
+		unsigned int mask = (~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xFFFF;
+		if(mask) {
+			return(i + ARTD_CTZ(mask));
+		}
+	}
+	int ret = scalarMismatchIgnoreCase(a + i, b + i, len - i);
+	return(ret < 0 ? ret : i + ret);
+}
+
+void sse2CaseFold(char *out, const char *in, int len, bool toUpper)
+{
+	int i = 0;
+	if(toUpper) {
+		for(; i + 16 <= len; i += 16) {
+			_mm_storeu_si128((__m128i *)(out + i), sse2FoldUpper(_mm_loadu_si128((const __m128i *)(in + i))));
+		}
+	} else {
+		for(; i + 16 <= len; i += 16) {
+			_mm_storeu_si128((__m128i *)(out + i), sse2FoldLower(_mm_loadu_si128((const __m128i *)(in + i))));
+		}
+	}
+	scalarCaseFold(out + i, in + i, len - i, toUpper);
+}
+
+const StrKernels sse2Kernels = {
+	"sse2",
+	sse2IndexOfChar,
+	sse2LastIndexOfChar,
+	sse2IndexOfSub,
+	sse2MismatchIgnoreCase,
+	sse2CaseFold
+};
+
+// ********* AVX2 kernels, same algorithms 32 chars at a time
+
+ARTD_TARGET_AVX2 INL __m256i avx2FoldLower(__m256i v)
+{
+	const __m256i biased = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - 'A')));
+	const __m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), biased);
+	return(_mm256_or_si256(v, _mm256_and_si256(isUpper, _mm256_set1_epi8(0x20))));
+}
+
+ARTD_TARGET_AVX2 INL __m256i avx2FoldUpper(__m256i v)
+{
+	const __m256i biased = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - 'a')));
+	const __m256i isLower = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), biased);
+	return(_mm256_andnot_si256(_mm256_and_si256(isLower, _mm256_set1_epi8(0x20)), v));
+}
+
+ARTD_TARGET_AVX2 int avx2IndexOfChar(const char *s, int len, int ch)
+{
+	const __m256i needle = _mm256_set1_epi8((char)ch);
+	int i = 0;
+	for(; i + 32 <= len; i += 32) {
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s + i)), needle));
+		if(mask) {
+			return(i + ARTD_CTZ(mask));
+		}
+	}
+	int ret = sse2IndexOfChar(s + i, len - i, ch);
+	return(ret < 0 ? ret : i + ret);
+}
+
+ARTD_TARGET_AVX2 int avx2LastIndexOfChar(const char *s, int len, int ch)
+{
+	const __m256i needle = _mm256_set1_epi8((char)ch);
+	int i = len;
+	for(; i >= 32; i -= 32) {
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s + i - 32)), needle));
+		if(mask) {
+			return(i - 32 + (31 - ARTD_CLZ(mask)));
+		}
+	}
+	return(sse2LastIndexOfChar(s, i, ch));
+}
+
+ARTD_TARGET_AVX2 int avx2IndexOfSub(const char *s, int len, const char *sub, int subLen)
+{
+	const __m256i first = _mm256_set1_epi8(sub[0]);
+	const __m256i last = _mm256_set1_epi8(sub[subLen - 1]);
+	int i = 0;
+	for(; i + 32 + subLen - 1 <= len; i += 32) {
+		const __m256i blockFirst = _mm256_loadu_si256((const __m256i *)(s + i));
+		const __m256i blockLast = _mm256_loadu_si256((const __m256i *)(s + i + subLen - 1));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last)));
+		while(mask) {
+			const int bit = ARTD_CTZ(mask);
+			if(::memcmp(s + i + bit + 1, sub + 1, subLen - 2) == 0) {
+				return(i + bit);
+			}
+			mask &= mask - 1;
+		}
+	}
+	if(len - i < subLen) {
+		return(-1);
+	}
+	int ret = sse2IndexOfSub(s + i, len - i, sub, subLen);
+	return(ret < 0 ? ret : i + ret);
+}
+
+ARTD_TARGET_AVX2 int avx2MismatchIgnoreCase(const char *a, const char *b, int len)
+{
+	int i = 0;
+	for(; i + 32 <= len; i += 32) {
+		const __m256i va = avx2FoldLower(_mm256_loadu_si256((const __m256i *)(a + i)));
+		const __m256i vb = avx2FoldLower(_mm256_loadu_si256((const __m256i *)(b + i)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		if(mask) {
+			return(i + ARTD_CTZ(mask));
+		}
+	}
+	int ret = sse2MismatchIgnoreCase(a + i, b + i, len - i);
+	return(ret < 0 ? ret : i + ret);
+}
+
+ARTD_TARGET_AVX2 void avx2CaseFold(char *out, const char *in, int len, bool toUpper)
+{
+	int i = 0;
+	if(toUpper) {
+		for(; i + 32 <= len; i += 32) {
+			_mm256_storeu_si256((__m256i *)(out + i), avx2FoldUpper(_mm256_loadu_si256((const __m256i *)(in + i))));
+		}
+	} else {
+		for(; i + 32 <= len; i += 32) {
+			_mm256_storeu_si256((__m256i *)(out + i), avx2FoldLower(_mm256_loadu_si256((const __m256i *)(in + i))));
+		}
+	}
+	sse2CaseFold(out + i, in + i, len - i, toUpper);
+}
+
+const StrKernels avx2Kernels = {
+	"avx2",
+	avx2IndexOfChar,
+	avx2LastIndexOfChar,
+	avx2IndexOfSub,
+	avx2MismatchIgnoreCase,
+	avx2CaseFold
+};
+
+bool cpuHasAvx2()
+{
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("avx2"));
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7) {
+		return(false);
+	}
+	__cpuid(info, 1);
+	// OSXSAVE and AVX, then the OS must be saving the ymm state
+	if((info[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28))) {
+		return(false);
+	}
+	if((_xgetbv(0) & 0x06) != 0x06) {
+		return(false);
+	}
+	__cpuidex(info, 7, 0);
+	return((info[1] & (1 << 5)) != 0);
+#else
+	return(false);
+#endif
+}
+
+#endif // ARTD_STRALGO_X86
+
+const StrKernels *selectKernels()
+{
+#ifdef ARTD_STRALGO_X86
+	if(cpuHasAvx2()) {
+		return(&avx2Kernels);
+	}
+	return(&sse2Kernels);
+#else
+	return(&scalarKernels);
+#endif
+}
+
+// Selected on first use as static RcStrings may be initialized before this module is.
+// A race on first use is harmless as every thread selects the same table.
+std::atomic<const StrKernels *> selectedKernels(nullptr);
+
+INL const StrKernels &K()
+{
+	const StrKernels *k = selectedKernels.load(std::memory_order_relaxed);
+	if(!k) {
+		k = selectKernels();
+		selectedKernels.store(k, std::memory_order_relaxed);
+	}
+	return(*k);
+}
+
+INL bool clipFromIndex(int &fromIndex, int len)
+{
+	if(fromIndex < 0) {
+		fromIndex = 0;
+	}
+	return(fromIndex <= len);
+}
+
+} // anonymous
+
+const char *
+StringAlgo::kernelName()
+{
+	return(K().name);
+}
+
+int
+StringAlgo::indexOf(const char *s, int len, int ch, int fromIndex)
+{
+	if(!clipFromIndex(fromIndex, len)) {
+		return(-1);
+	}
+	int ret = K().indexOfChar(s + fromIndex, len - fromIndex, ch);
+	return(ret < 0 ? ret : fromIndex + ret);
+}
+
+int
+StringAlgo::indexOf(const char *s, int len, const char *sub, int subLen, int fromIndex)
+{
+	if(!clipFromIndex(fromIndex, len)) {
+		return(-1);
+	}
+	const int remaining = len - fromIndex;
+	if(subLen > remaining) {
+		return(-1);
+	}
+	int ret;
+	if(subLen <= 1) {
+		if(subLen <= 0) {
+			return(fromIndex);
+		}
+		ret = K().indexOfChar(s + fromIndex, remaining, (unsigned char)sub[0]);
+	} else {
+		ret = K().indexOfSub(s + fromIndex, remaining, sub, subLen);
+	}
+	return(ret < 0 ? ret : fromIndex + ret);
+}
+
+int
+StringAlgo::lastIndexOf(const char *s, int len, int ch)
+{
+	return(K().lastIndexOfChar(s, len, ch));
+}
+
+int
+StringAlgo::lastIndexOf(const char *s, int len, const char *sub, int subLen)
+{
+	if(subLen > len) {
+		return(-1);
+	}
+	if(subLen <= 0) {
+		return(len);
+	}
+	const StrKernels &k = K();
+	const int first = (unsigned char)sub[0];
+
+	// candidates are positions of the first char no later than len - subLen
+	int limit = len - subLen + 1;
+	while(limit > 0) {
+		int pos = k.lastIndexOfChar(s, limit, first);
+		if(pos < 0) {
+			break;
+		}
+		if(::memcmp(s + pos + 1, sub + 1, subLen - 1) == 0) {
+			return(pos);
+		}
+		limit = pos;
+	}
+	return(-1);
+}
+
+bool
+StringAlgo::equalsIgnoreCase(const char *a, const char *b, int len)
+{
+	if(a == b) {
+		return(true);
+	}
+	return(K().mismatchIgnoreCase(a, b, len) < 0);
+}
+
+int
+StringAlgo::compareIgnoreCase(const char *a, int aLen, const char *b, int bLen)
+{
+	const int len = aLen < bLen ? aLen : bLen;
+	int ix = (a == b) ? -1 : K().mismatchIgnoreCase(a, b, len);
+	if(ix < 0) {
+		return(aLen - bLen);
+	}
+	return(toLowerAscii((unsigned char)a[ix]) - toLowerAscii((unsigned char)b[ix]));
+}
+
+void
+StringAlgo::toLower(char *out, const char *in, int len)
+{
+	K().caseFold(out, in, len, false);
+}
+
+void
+StringAlgo::toUpper(char *out, const char *in, int len)
+{
+	K().caseFold(out, in, len, true);
+}
+
+// 8 bytes at a time multiply and rotate then a murmur3 style finalizer
+uint32_t
+StringAlgo::hash(const char *s, int len)
+{
+	const uint64_t m1 = 0x9E3779B97F4A7C15ull;
+	const uint64_t m2 = 0xC2B2AE3D27D4EB4Full;
+	uint64_t h = m1 ^ (uint64_t)(uint32_t)len;
+	const char *max = s + (len & ~7);
+	uint64_t k;
+
+	while(s < max) {
+		::memcpy(&k, s, sizeof(k));
+		s += sizeof(k);
+		k *= m2;
+		k = (k << 31) | (k >> 33);
+		h = ((h ^ k) * m1) + 0x52DCE729;
+	}
+	if(len & 7) {
+		k = 0;
+		::memcpy(&k, s, len & 7);
+		k *= m2;
+		k = (k << 31) | (k >> 33);
+		h ^= k * m1;
+	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+
+	const uint32_t ret = (uint32_t)(h ^ (h >> 32));
+	return(ret ? ret : 1);
+}
+
+// ********* wchar_t
+
+int
+StringAlgo::indexOf(const wchar_t *s, int len, int ch, int fromIndex)
+{
+	if(!clipFromIndex(fromIndex, len)) {
+		return(-1);
+	}
+	const wchar_t *p = ::wmemchr(s + fromIndex, (wchar_t)ch, len - fromIndex);
+	return(p ? (int)(p - s) : -1);
+}
+
+int
+StringAlgo::indexOf(const wchar_t *s, int len, const wchar_t *sub, int subLen, int fromIndex)
+{
+	if(!clipFromIndex(fromIndex, len)) {
+		return(-1);
+	}
+	if(subLen <= 0) {
+		return(fromIndex);
+	}
+	const wchar_t *p = s + fromIndex;
+	const wchar_t *pmax = s + (len - subLen);
+	while(p <= pmax) {
+		p = ::wmemchr(p, sub[0], (pmax - p) + 1);
+		if(!p) {
+			break;
+		}
+		if(::wmemcmp(p + 1, sub + 1, subLen - 1) == 0) {
+			return((int)(p - s));
+		}
+		++p;
+	}
+	return(-1);
+}
+
+int
+StringAlgo::lastIndexOf(const wchar_t *s, int len, int ch)
+{
+	while(--len >= 0) {
+		if(s[len] == (wchar_t)ch) {
+			break;
+		}
+	}
+	return(len);
+}
+
+int
+StringAlgo::lastIndexOf(const wchar_t *s, int len, const wchar_t *sub, int subLen)
+{
+	if(subLen > len) {
+		return(-1);
+	}
+	if(subLen <= 0) {
+		return(len);
+	}
+	for(int pos = len - subLen; pos >= 0; --pos) {
+		if(s[pos] == sub[0] && ::wmemcmp(s + pos, sub, subLen) == 0) {
+			return(pos);
+		}
+	}
+	return(-1);
+}
+
+bool
+StringAlgo::equalsIgnoreCase(const wchar_t *a, const wchar_t *b, int len)
+{
+	for(int i = 0; i < len; ++i) {
+		if(a[i] != b[i] && toLowerAscii(a[i]) != toLowerAscii(b[i])) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+int
+StringAlgo::compareIgnoreCase(const wchar_t *a, int aLen, const wchar_t *b, int bLen)
+{
+	const int len = aLen < bLen ? aLen : bLen;
+	for(int i = 0; i < len; ++i) {
+		int diff = toLowerAscii(a[i]) - toLowerAscii(b[i]);
+		if(diff) {
+			return(diff);
+		}
+	}
+	return(aLen - bLen);
+}
+
+void
+StringAlgo::toLower(wchar_t *out, const wchar_t *in, int len)
+{
+	for(const wchar_t *max = in + len; in < max;) {
+		*out++ = (wchar_t)toLowerAscii(*in++);
+	}
+}
+
+void
+StringAlgo::toUpper(wchar_t *out, const wchar_t *in, int len)
+{
+	for(const wchar_t *max = in + len; in < max;) {
+		*out++ = (wchar_t)toUpperAscii(*in++);
+	}
+}
+
+ARTD_END
@@ -27,6 +27,18 @@
 #include "artd/int_types.h"
 #include "artd/platform_base.h"
 #include "artd/static_assert.h"
+#include "artd/utf8util.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__has_include)
+	#if __has_include(<charconv>)
+		#include <charconv>
+	#endif
+#endif
+#if defined(__cpp_lib_to_chars)
+	#define ARTD_CSTRING_TO_CHARS
+#endif
 
 // #include "artd/platform_specific.h"
 #ifdef ARTD_WINDOWS
@@ -48,14 +60,30 @@ char c;
 	}
 }
 
+// Both follow the Windows conventions, the return is the size in output units
+// including the terminal null, if dest is null or len is 0 only the size is
+// returned and 0 is returned if dest is too small. On other platforms utf8
+// conversions use Utf8 and don't depend on the process locale.
+
 int 
 wideCharToMultiByte(const wchar_t *src, char *dest, int len, bool utf8)
 {
 	#ifdef ARTD_WINDOWS
 		int clen = ::WideCharToMultiByte(utf8 ? CP_UTF8 : CP_ACP,0,src,-1,dest,len,NULL,NULL);
 	#else
-		// TODO: Proper handling of the utf8 parameter
-		int clen = wcstombs(dest, src, len) + 1;
+		int clen;
+		if(utf8) {
+			const int srcLen = (int)::wcslen(src);
+			clen = Utf8::encodedSize(src, srcLen) + 1;
+			if(dest && len > 0) {
+				if(clen > len) {
+					return(0);
+				}
+				*Utf8::encodeTo(dest, src, srcLen) = 0;
+			}
+		} else {
+			clen = (int)wcstombs((dest && len > 0) ? dest : NULL, src, len) + 1;
+		}
 	#endif
 	return clen;
 }
@@ -66,8 +94,19 @@ multiByteToWideChar(const char *src, wchar_t *dest, int len, bool utf8)
 	#ifdef ARTD_WINDOWS
 		int clen = ::MultiByteToWideChar(utf8 ? CP_UTF8 : CP_ACP,0,src,-1,dest,len);
 	#else
-		// TODO: Proper handling of the utf8 parameter
-		int clen = mbstowcs(dest, src, len) + 1;
+		int clen;
+		if(utf8) {
+			const int srcLen = (int)::strlen(src);
+			clen = Utf8::decodedLength(src, srcLen) + 1;
+			if(dest && len > 0) {
+				if(clen > len) {
+					return(0);
+				}
+				*Utf8::decodeTo(dest, src, srcLen) = 0;
+			}
+		} else {
+			clen = (int)mbstowcs((dest && len > 0) ? dest : NULL, src, len) + 1;
+		}
 	#endif
 	return clen;
 }
@@ -102,192 +141,130 @@ void reverseBytes(uint8_t *start,uint8_t *end)
 		*end-- = swapper;
 	}
 }
-static int intToText(bool isNegative,unsigned int val,char *buf,unsigned int radix)
+// pairs of decimal digits "00" to "99" so two digits are done per divide
+static const char DigitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char RadixDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+static ARTD_ALWAYS_INLINE int decimalDigits(uint64_t val)
 {
-char *out;  
-char *first;
-
-	out = buf;
-
-	if(isNegative) // add sign and negate it if requested
-	{
-		*out++ = '-';
-		val = (unsigned int)(-(int)val);
-	}
-
-	first = out;
-
-	for(;;)
-	{
-		unsigned int digit = (unsigned int)(val % radix);
-		val /= radix; // next digit
-
-		if (digit > 9)
-			*out++ = digit + ('a' - 10); // hex representation
-		else
-			*out++ = (digit + '0');        // normal digit
-
-		if(val <= 0) // none left of value
-			break;
-	} 
-
-	*out = 0; // terminate end of buffer
-	int len = (int)(out - first);
-	--out;
-
-	// reverse buffer since it was built in reverse
-	
+	int count = 1;
 	for(;;)
 	{
-		char swaper = *out;
-		*out = *first;
-		*first = swaper;  // swap chars;
-		--out;
-		if(++first >= out)  // done at middle
-			break;
+		if(val < 10) return(count);
+		if(val < 100) return(count + 1);
+		if(val < 1000) return(count + 2);
+		if(val < 10000) return(count + 3);
+		val /= 10000;
+		count += 4;
 	}
-	return(len);
 }
 
-static int int64ToText(bool isNegative,uint64_t val,char *buf,uint64_t radix)
+// Writes the digits of val null terminated to out and returns the number of them.
+// The length is known before writing so the digits are put in place from the
+// end, two at a time for decimal and by shifting for power of 2 radixes, and
+// nothing needs reversing.
+template<class CharT, class UIntT>
+static int digitsToText(UIntT val, CharT *out, unsigned int radix)
 {
-char *out;  
-char *first;
-
-	out = buf;
+	int len;
 
-	if(isNegative) // add sign and negate it if requested
+	if(radix == 10)
 	{
-		*out++ = '-';
-		val = (uint64_t)(-(int64_t)val);
+		len = decimalDigits(val);
+		CharT *p = out + len;
+		*p = 0;
+		while(val >= 100)
+		{
+			const char *pair = &DigitPairs[(val % 100) * 2];
+			val /= 100;
+			*--p = pair[1];
+			*--p = pair[0];
+		}
+		if(val >= 10)
+		{
+			const char *pair = &DigitPairs[val * 2];
+			*--p = pair[1];
+			*--p = pair[0];
+		}
+		else
+		{
+			*--p = (CharT)('0' + val);
+		}
+		return(len);
 	}
-
-	first = out;
-
-	for(;;)
+	if((radix & (radix - 1)) == 0 && radix >= 2)
 	{
-		uint64_t digit = (uint64_t)(val % radix);
-		val /= radix; // next digit
-
-		if (digit > 9)
-			*out++ = (char) (digit + ('a' - 10)); // hex representation
-		else
-			*out++ = (char) (digit + '0');        // normal digit
-
-		if(val <= 0) // none left of value
-			break;
-	} 
-
-	*out = 0; // terminate end of buffer
-	int len = (int)(out - first);
-	--out;
+		int shift = 0;
+		while((1u << shift) < radix) {
+			++shift;
+		}
+		const UIntT mask = (UIntT)(radix - 1);
+		len = 1;
+		for(UIntT v = val >> shift; v != 0; v >>= shift) {
+			++len;
+		}
+		CharT *p = out + len;
+		*p = 0;
+		do {
+			*--p = (CharT)RadixDigits[val & mask];
+			val >>= shift;
+		} while(val != 0);
+		return(len);
+	}
 
-	// reverse buffer since it was built in reverse
-	
-	for(;;)
-	{
-		char swaper = *out;
-		*out = *first;
-		*first = swaper;  // swap chars;
-		--out;
-		if(++first >= out)  // done at middle
-			break;
+	// any other radix is rare, do it the long way
+	CharT digits[sizeof(UIntT) * 8];
+	CharT *end = digits + (sizeof(digits) / sizeof(CharT));
+	CharT *p = end;
+	do {
+		*--p = (CharT)RadixDigits[val % radix];
+		val /= radix;
+	} while(val != 0);
+	len = (int)(end - p);
+	for(int i = 0; i < len; ++i) {
+		out[i] = p[i];
 	}
+	out[len] = 0;
 	return(len);
 }
 
-static int intToText(bool isNegative,unsigned int val,wchar_t *buf,unsigned int radix)
+template<class CharT, class UIntT>
+static ARTD_ALWAYS_INLINE int integerToText(bool isNegative, UIntT val, CharT *buf, unsigned int radix)
 {
-wchar_t *out;  
-wchar_t *first;
-
-	out = buf;
-
 	if(isNegative) // add sign and negate it if requested
 	{
-		*out++ = '-';
-		val = (unsigned int)(-(int)val);
+		*buf = '-';
+		return(1 + digitsToText((UIntT)(((UIntT)0) - val), buf + 1, radix));
 	}
-
-	first = out;
-
-	for(;;)
-	{
-		unsigned int digit = (unsigned int)(val % radix);
-		val /= radix; // next digit
-
-		if (digit > 9)
-			*out++ = digit + ('a' - 10); // hex representation
-		else
-			*out++ = (digit + '0');        // normal digit
-
-		if(val <= 0) // none left of value
-			break;
-	} 
-
-	*out = 0; // terminate end of buffer
-	int len = (int)(out - first);
-	--out;
-
-	// reverse buffer since it was built in reverse
-	
-	for(;;)
-	{
-		wchar_t swaper = *out;
-		*out = *first;
-		*first = swaper;  // swap chars;
-		--out;
-		if(++first >= out)  // done at middle
-			break;
-	} 
-	return(len);
+	return(digitsToText(val, buf, radix));
 }
 
+static int intToText(bool isNegative,unsigned int val,char *buf,unsigned int radix)
+{
+	return(integerToText(isNegative, val, buf, radix));
+}
+static int int64ToText(bool isNegative,uint64_t val,char *buf,uint64_t radix)
+{
+	return(integerToText(isNegative, val, buf, (unsigned int)radix));
+}
+static int intToText(bool isNegative,unsigned int val,wchar_t *buf,unsigned int radix)
+{
+	return(integerToText(isNegative, val, buf, radix));
+}
 static int int64ToText(bool isNegative,uint64_t val,wchar_t *buf,uint64_t radix)
 {
-wchar_t *out;  
-wchar_t *first;
-
-	out = buf;
-
-	if(isNegative) // add sign and negate it if requested
-	{
-		*out++ = '-';
-		val = (uint64_t)(-(int64_t)val);
-	}
-
-	first = out;
-
-	for(;;)
-	{
-		uint64_t digit = (uint64_t)(val % radix);
-		val /= radix; // next digit
-
-		if (digit > 9)
-			*out++ = (wchar_t) (digit + ('a' - 10)); // hex representation
-		else
-			*out++ = (wchar_t) (digit + '0');        // normal digit
-
-		if(val <= 0) // none left of value
-			break;
-	} 
-
-	*out = 0; // terminate end of buffer
-	int len = (int)(out - first);
-	--out;
-
-	// reverse buffer since it was built in reverse
-	
-	for(;;)
-	{
-		wchar_t swaper = *out;
-		*out = *first;
-		*first = swaper;  // swap chars;
-		--out;
-		if(++first >= out)  // done at middle
-			break;
-	} 
-	return(len);
+	return(integerToText(isNegative, val, buf, (unsigned int)radix));
 }
 
 int itostr(int num,char *out,int radix)
@@ -362,6 +339,48 @@ int ul64tostr(uint64_t num,wchar_t *out,int radix)
 	return(int64ToText(false,num,out,radix));
 }
 
+#ifdef ARTD_CSTRING_TO_CHARS
+
+int dtostr(double num, char *out)
+{
+	std::to_chars_result r = std::to_chars(out, out + MaxRealTextLength, num);
+	*r.ptr = 0;
+	return((int)(r.ptr - out));
+}
+int ftostr(float num, char *out)
+{
+	std::to_chars_result r = std::to_chars(out, out + MaxRealTextLength, num);
+	*r.ptr = 0;
+	return((int)(r.ptr - out));
+}
+
+#else
+
+// without std::to_chars() find the fewest digits that read back the same
+template<class RealT>
+static int realToText(RealT num, char *out, int maxDigits)
+{
+	int len = 0;
+	for(int digits = 1; digits <= maxDigits; ++digits)
+	{
+		len = ::snprintf(out, MaxRealTextLength + 1, "%.*g", digits, (double)num);
+		if((RealT)::strtod(out, nullptr) == num || num != num) {
+			break;
+		}
+	}
+	return(len);
+}
+int dtostr(double num, char *out)
+{
+	return(realToText(num, out, 17));
+}
+int ftostr(float num, char *out)
+{
+	return(realToText(num, out, 9));
+}
+
+#endif
+
 // bodge for now, assume decimal integer is no longer than 64
 // digits (raltively safe)
 int strtoi(const wchar_t *in, int len)
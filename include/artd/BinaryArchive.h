@@ -0,0 +1,180 @@
+#ifndef __artd_BinaryArchive_h
+#define __artd_BinaryArchive_h
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/RcArray.h"
+#include "artd/RcVector.h"
+#include "artd/RcString.h"
+#include "artd/StringArg.h"
+#include "artd/Uuid.h"
+#include "artd/ArtdClassId.h"
+#include <string_view>
+#include <type_traits>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * Compact binary image of a tree of strings, arrays, Uuids and ArtdClassIds
+ * that can be used in place, ie: mapped from a file with no parsing.
+ *
+ * An archive is a table of entries referred to by index.  Each entry is
+ * 8 byte aligned and starts with its type and a length, strings are utf8
+ * with a null, arrays are the raw elements of trivially copyable types,
+ * and lists hold the indices of other entries so trees can be built.
+ *
+ *   header     "ARTDARC", version, entry count, table offset, root, byte order
+ *   entries    { uint32 type, uint32 length, payload, padding to 8 }...
+ *   table      uint64 offset of each entry
+ *
+ * The image is in the writing machine's byte order, loading one with the
+ * other order fails.
+ */
+class ARTD_API_JLIB_BASE BinaryArchive
+{
+public:
+	enum EntryType {
+		tNONE = 0,
+		tSTRING = 1,
+		tARRAY = 2,
+		tUUID = 3,
+		tCLASSID = 4,
+		tLIST = 5
+	};
+
+	INL BinaryArchive() {}
+
+	/**
+	 * @brief archive in image, which is validated once here so the accessors
+	 * need no checks beyond the entry type. Check isValid() after.
+	 */
+	explicit BinaryArchive(const ByteArray &image);
+
+	/** @brief maps an archive file with MappedFile, nothing is read until used */
+	static BinaryArchive open(const char *path);
+
+	INL bool isValid() const { return(count_ >= 0); }
+	INL int count() const { return(count_ < 0 ? 0 : count_); }
+	/** @brief the entry index the writer gave as the root of the tree */
+	INL int root() const { return(root_); }
+	INL const ByteArray &image() const { return(image_); }
+
+	/** @brief the type of entry ix or tNONE if out of range */
+	EntryType type(int ix) const;
+
+	/** @brief chars of a string entry in the image, no copy, empty if not a string */
+	std::string_view stringView(int ix) const;
+	/** @brief a string entry as a StringArg on the image, which is null terminated */
+	INL StringArg stringArg(int ix) const {
+		std::string_view v = stringView(ix);
+		return(StringArg(v.data(), (int)v.size()));
+	}
+	/** @brief a string entry copied into a new RcString, null if not a string */
+	RcString string(int ix) const;
+
+	/** @brief elements of an array entry of ElemT without copying, null if not an array of that size of element */
+	template<class ElemT>
+	RcArray<ElemT> array(int ix) const {
+		static_assert(std::is_trivially_copyable<ElemT>::value && alignof(ElemT) <= 8,
+					  "archived arrays need trivially copyable elements aligned to at most 8");
+		int length;
+		void *elems = arrayElements(ix, sizeof(ElemT), &length);
+		if(!elems) {
+			return(nullptr);
+		}
+		return(RcArray<ElemT>::subArray(image_, (ElemT *)elems, length));
+	}
+
+	Uuid uuid(int ix) const;
+	ArtdClassId classId(int ix) const;
+
+	/** @brief number of items in a list entry, 0 if not a list */
+	int listSize(int ix) const;
+	/** @brief entry index of item i of a list entry */
+	int listItem(int ix, int i) const;
+
+private:
+	friend class BinaryArchiveWriter;
+
+	struct Entry;
+	const Entry *entry(int ix, EntryType type) const;
+	void *arrayElements(int ix, int elemSize, int *length) const;
+
+	ByteArray image_;
+	const uint64_t *table_ = nullptr;
+	int count_ = -1;
+	int root_ = -1;
+};
+
+/**
+ * Builds a BinaryArchive image, each add call appends an entry and returns
+ * its index for use in lists and as the root.
+ */
+class ARTD_API_JLIB_BASE BinaryArchiveWriter
+{
+public:
+	BinaryArchiveWriter();
+
+	int addString(const StringArg &s);
+
+	template<class ElemT>
+	int addArray(const ElemT *elements, int length) {
+		static_assert(std::is_trivially_copyable<ElemT>::value && alignof(ElemT) <= 8,
+					  "archived arrays need trivially copyable elements aligned to at most 8");
+		return(addArrayBytes(elements, length, sizeof(ElemT)));
+	}
+	template<class ElemT>
+	INL int addArray(const RcArray<ElemT> &a) {
+		return(addArray(a ? a.elements() : (const ElemT *)nullptr, a ? a.length() : 0));
+	}
+
+	int addUuid(const Uuid &id);
+	int addClassId(const ArtdClassId &id);
+	/** @brief list of count entry indices, which must already have been added */
+	int addList(const int *items, int count);
+
+	INL int count() const { return((int)offsets_.size()); }
+
+	/** @brief completes the image with root as the root entry, the writer is left empty */
+	ByteArray finish(int root);
+	/** @brief finish() and write the image to a file, false if it could not be written */
+	bool writeFile(const char *path, int root);
+
+private:
+	int addArrayBytes(const void *elements, int length, int elemSize);
+	int beginEntry(BinaryArchive::EntryType type, uint32_t length);
+	void appendBytes(const void *data, size_t size);
+	void pad();
+
+	RcVector<uint8_t> bytes_;
+	RcVector<uint64_t> offsets_;
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_BinaryArchive_h
@@ -0,0 +1,100 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#ifndef __artd_ByteArrayPool_h
+#define __artd_ByteArrayPool_h
+
+#include "artd/RcArray.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+ARTD_BEGIN
+
+/**
+ * Recycles the memory of ByteArrays used as I/O buffers.
+ *
+ * acquire() returns an ordinary ByteArray allocated in a block from one of
+ * the pool's power of 2 size classes.  When the last reference to it is
+ * released the block goes back to the pool rather than the heap, so once
+ * the pool has warmed up a steady I/O load does no heap allocation.
+ *
+ * Free blocks are kept on a free list per size class.  For shared() each
+ * thread also keeps a few free blocks per class so most acquires and
+ * releases take no lock.  The free blocks held by the pool are capped at
+ * maxPooledBytes, past that released blocks are freed.  Arrays larger than
+ * MaxBlockSize are not pooled.
+ *
+ * A pool must outlive the arrays acquired from it, shared() is never
+ * destroyed.  Other pools keep no per thread blocks so they may be
+ * destroyed while the threads that used them run on.
+ */
+class ARTD_API_JLIB_BASE ByteArrayPool
+	: private RcArrayBlockSource
+{
+public:
+	static const size_t MinBlockSize = 256;
+	static const size_t MaxBlockSize = 16 * 1024 * 1024;
+	static const int NumClasses = 17; // MinBlockSize << 16 == MaxBlockSize
+
+	explicit ByteArrayPool(size_t maxPooledBytes = 64 * 1024 * 1024);
+	~ByteArrayPool() override;
+
+	/** @brief process wide pool */
+	static ByteArrayPool &shared();
+
+	/** @brief a ByteArray of length bytes, left uninitialized unless zeroed is set */
+	ByteArray acquire(int length, bool zeroed = false);
+
+	/** @brief bytes in free blocks held by the pool */
+	size_t pooledBytes() const { return(pooledBytes_.load(std::memory_order_relaxed)); }
+	/** @brief number of blocks the pool has allocated from the heap */
+	size_t heapAllocations() const { return(heapAllocations_.load(std::memory_order_relaxed)); }
+
+	/** @brief frees the blocks on the shared free lists */
+	void trim();
+
+private:
+	friend class ByteArrayPoolCache;
+
+	void *takeBlock(size_t blockSize) override;
+	void giveBlock(void *block, size_t blockSize) override;
+
+	void *takeShared(int sizeClass);
+	void giveShared(void *block, int sizeClass);
+
+	static int classFor(size_t size);
+	static size_t classSize(int sizeClass) { return(MinBlockSize << sizeClass); }
+
+	const size_t maxPooledBytes_;
+	bool threadCached_;  // only shared(), per thread blocks can outlive other pools
+	std::atomic<size_t> pooledBytes_;
+	std::atomic<size_t> heapAllocations_;
+	std::mutex lock_;
+	std::vector<void *> free_[NumClasses];
+};
+
+ARTD_END
+
+#endif // __artd_ByteArrayPool_h
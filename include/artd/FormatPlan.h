@@ -0,0 +1,129 @@
+/*-
+ * Copyright (c) 1991-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ * 
+ *  $Id$
+ */
+
+#ifndef __artd_FormatPlan_h
+#define __artd_FormatPlan_h
+
+#include "artd/FormatfSink.h"
+#include "artd/RcString.h"
+#include <vector>
+
+#define INL ARTD_ALWAYS_INLINE
+
+ARTD_BEGIN
+
+/**
+ * A "char" format string parsed once into a list of literal runs and
+ * conversions, for formats only known at run time that are used many
+ * times, ie: translated strings.
+ *
+ * Literal runs are copied in blocks and plain %d %i %u %s conversions are
+ * written straight from the FormatfArglist argument, anything else is handed
+ * to FormatfStream one conversion at a time, so the output is the same as
+ * formatting with FormatfStream. Positional "%n$" arguments are supported,
+ * as they are by FormatfStream.
+ *
+ * A format with an invalid conversion or %n is formatted by FormatfStream
+ * as a whole.
+ *
+ *   FormatPlan::cached(translated)->format(name, count);
+ */
+class ARTD_API_JLIB_BASE FormatPlan
+	: public ObjectBase
+{
+public:
+	typedef FormatfArgBase::Arg Arg;
+
+	/** use parse() or cached() */
+	explicit FormatPlan(const char *fmt);
+	~FormatPlan();
+
+	/** @brief a new plan for fmt */
+	static ObjectPtr<FormatPlan> parse(const char *fmt);
+
+	/**
+	 * @brief the plan for fmt from a per thread cache keyed by the format
+	 * pointer. The cached plan is checked against the format's chars so a
+	 * pointer re-used for a different format gets a new plan.
+	 */
+	static ObjectPtr<FormatPlan> cached(const char *fmt);
+
+	/** @brief the format as parsed */
+	INL const char *formatString() const { return(fmt_.data()); }
+	/** @brief number of arguments the conversions use */
+	INL int argCount() const { return(argCount_); }
+	/** @brief false if the format is formatted as a whole by FormatfStream */
+	INL bool isPlanned() const { return(planned_); }
+
+	void write(FormatfBuffer &out, const Arg *args, int count) const;
+	/** @brief formats to sink, returns the number of bytes written */
+	int vwriteTo(FormatfSink &sink, const FormatfArglist<> &args) const;
+	RcString vformat(const FormatfArglist<> &args) const;
+
+	template <typename... Args>
+	INL RcString format(const Args &... args) const {
+		FormatfArglist<sizeof...(Args)> arglist;
+		FormatfArglist<>::addArgs(arglist.args(), args...);
+		return(vformat(arglist));
+	}
+	template <typename... Args>
+	INL int writeTo(FormatfSink &sink, const Args &... args) const {
+		FormatfArglist<sizeof...(Args)> arglist;
+		FormatfArglist<>::addArgs(arglist.args(), args...);
+		return(vwriteTo(sink, arglist));
+	}
+
+private:
+	enum OpType {
+		opLITERAL,  // length chars of fmt_ at start
+		opINT,      // plain %d %i
+		opUINT,     // plain %u
+		opCHARS,    // plain %s %t
+		opFORMAT    // by FormatfStream
+	};
+	struct Op
+	{
+		uint8_t type;
+		uint8_t dlong;   // "ll" given
+		uint16_t arg;    // the argument used
+		int start;       // in fmt_ for literals, the spec in specs_ for the rest
+		int length;
+	};
+
+	bool parseSpec(int &i, int &nextArg);
+	int addSpec(int specStart, int specEnd, int firstArg, bool positional);
+	void writeSpec(FormatfBuffer &out, const Op &op, const Arg *args, int count) const;
+
+	std::vector<char> fmt_;     // copy of the format with its null
+	std::vector<char> specs_;   // null terminated specs for opFORMAT
+	std::vector<Op> ops_;
+	int argCount_;
+	bool planned_;
+};
+
+ARTD_END
+
+#undef INL
+
+#endif // __artd_FormatPlan_h
@@ -39,6 +39,8 @@
 
 ARTD_BEGIN
 
+class FormatfSink;
+
 class FormatPtr 
 {
 public:
@@ -74,6 +76,9 @@ public:
  * %w explicitly a wchar_t string 
  * %b integer as binary base 2 digits
  *          ie: "->%08b<-", 0x071 is formatted as "->01110001<-" 
+ * %n$ and *n$ take argument n (from 1) as in posix, following conversions
+ *          continue from the one after it.  ie: "%2$s %1$s"
+ *          Only for FormatfArglist arguments, not a va_list.
  */
 
 #pragma warning( push )
@@ -133,6 +138,22 @@ public:
 	int     read(char  *out,int maxbytes);
 	int     read(wchar_t *out,int maxbytes);
 
+	/**
+	 * If the next output is a run of ascii chars already in memory, literal
+	 * text from the format, a string argument, formatted digits or padding,
+	 * sets *span to it and returns its length, up to maxChars, consuming it
+	 * as if get() had been called for each. Returns 0 if the next char must
+	 * come from get(). The span is only valid until the next call.
+	 * read(), lenf() and sizef() use this to copy output in blocks.
+	 */
+	int     getSpan(const char **span, int maxChars);
+
+	/**
+	 * formats everything left in the stream to sink in one pass as utf8.
+	 * returns the number of bytes written.
+	 */
+	int     writeTo(FormatfSink &sink);
+
 	/**
 	 * same as read() but null terminates
 	 * the output.  It will read up to 
@@ -286,6 +307,7 @@ public:
 	void va_init(const char *fmt, const FormatfArglist<> &arglist)
 	{
         argbuf_.args = arglist.args();
+        argBase_	= argbuf_.args;
         argCount_	= arglist.argCount();
 		root_       = geta_fmtchar;
 		arg_        = &arglistGetter_;
@@ -294,6 +316,7 @@ public:
 	void va_init(const wchar_t *fmt,const FormatfArglist<> &arglist)
 	{
 		argbuf_.args = arglist.args();
+		argBase_ = argbuf_.args;
 		argCount_ = arglist.argCount();
 		root_ = geta_fmtchar;
 		arg_ = &arglistGetter_;
@@ -302,6 +325,7 @@ public:
 	void va_init(const FormatPtr &fp, const FormatfArglist<> &arglist)
 	{
         argbuf_.args = arglist.args();
+        argBase_	= argbuf_.args;
         argCount_	= arglist.argCount();
 		root_       = geta_fmtchar;
 		arg_        = &arglistGetter_;
@@ -311,6 +335,16 @@ public:
 			startFormat((const wchar_t *)fp.fmt_);
 		}
 	}
+	/** @brief initialize for count arguments in an array, ie: part of a FormatfArglist */
+	void va_init(const char *fmt, const Arg *args, int count)
+	{
+		argbuf_.args = args;
+		argBase_	= args;
+		argCount_	= count;
+		root_       = geta_fmtchar;
+		arg_        = &arglistGetter_;
+		startFormat(fmt);
+	}
 	/** @brief special case for initializing with one argument and formatting only it with no 
 	 *  added format specifications. ie: "%s" not "%.4s", format type selected by arg type.
 	 */
@@ -438,6 +472,7 @@ protected:
 	} argbuf_;
 
     int argCount_;  // used for variadic template args "Arg" only
+    const Arg *argBase_; // first of the "Arg"s for positional %n$ arguments
 	int argType_;   // valid type for FormatfArglist set to tNONE (0) otherwise
 
 	typedef int (*GetchT)(FormatfStreamBase *fa);  // current 'getchar' function
@@ -485,11 +520,9 @@ protected:
 	 * public header clean
 	 */
 	enum {
-		#ifdef ARTD_64BIT
-			PrivateSize = 88 + (62 * sizeof(char)), 
-		#else
-			PrivateSize = 46 + (62 * sizeof(char)), 
-		#endif
+		// the 3 pointers in FormatfPrivate with room for alignment and the
+		// shorts, ints, double and 360 char number buffer
+		PrivateSize = (4 * sizeof(void *)) + 396,
 	};
 	
 	char _private_[PrivateSize];  // used internally, keeps public header clean
@@ -53,12 +53,12 @@ public:
         
         INL Arg() : type_(tNONE) {}
         // note we have both const and non const versions. MSC will not assign a non const * to a const * overload (!)
-		INL Arg(const char *v) : type_(tCHARS) { value_.chars_ = v; }
-		INL Arg(char *v) : type_(tCHARS) { value_.chars_ = v; }
-		INL Arg(const wchar_t *v) : type_(tWCHARS) { value_.wchars_ = v; }
-		INL Arg(wchar_t *v) : type_(tWCHARS) { value_.wchars_ = v; }
+		INL Arg(const char *v) : type_(tCHARS), len_(-1) { value_.chars_ = v; }
+		INL Arg(char *v) : type_(tCHARS), len_(-1) { value_.chars_ = v; }
+		INL Arg(const wchar_t *v) : type_(tWCHARS), len_(-1) { value_.wchars_ = v; }
+		INL Arg(wchar_t *v) : type_(tWCHARS), len_(-1) { value_.wchars_ = v; }
 
-        explicit INL Arg(const bool &v) : type_(tCHARS) { value_.chars_ = (v ? "true" : "false"); }
+        explicit INL Arg(const bool &v) : type_(tCHARS), len_(v ? 4 : 5) { value_.chars_ = (v ? "true" : "false"); }
         explicit INL Arg(const char &v) : type_(tCHAR) { value_.uint_ = v; }
         explicit INL Arg(const wchar_t &v)   : type_(tWCHAR) { value_.uint_ = v; }
         explicit INL Arg(const uint16_t &v)  : type_(tUINT) { value_.uint_ = v; }
@@ -94,13 +94,15 @@ public:
         
     #ifdef ARTD_SUPPORT_STD_STRING
       #ifdef _MSC_VER
-        INL Arg(const std::string &v) : type_(tCHARS) { value_.chars_ = v.c_str(); }
-        INL Arg(const std::wstring &v) : type_(tWCHARS) { value_.wchars_ = v.c_str(); }
+        INL Arg(const std::string &v) : type_(tCHARS), len_((int)v.size()) { value_.chars_ = v.c_str(); }
+        INL Arg(const std::wstring &v) : type_(tWCHARS), len_((int)v.size()) { value_.wchars_ = v.c_str(); }
       #else
-        INL Arg(const std::string &v) : type_(tCHARS) { value_.chars_ = v.c_str(); }
-        INL Arg(const std::wstring &v) : type_(tWCHARS) { value_.wchars_ = v.c_str(); }
+        INL Arg(const std::string &v) : type_(tCHARS), len_((int)v.size()) { value_.chars_ = v.c_str(); }
+        INL Arg(const std::wstring &v) : type_(tWCHARS), len_((int)v.size()) { value_.wchars_ = v.c_str(); }
       #endif
     #endif
+        INL Arg(std::string_view v) : type_(tCHARS), len_((int)v.size()) { value_.chars_ = v.data(); }
+        INL Arg(std::wstring_view v) : type_(tWCHARS), len_((int)v.size()) { value_.wchars_ = v.data(); }
         
         INL void releaseObj() {
             if(type_ >= tRCSTR) {
@@ -147,6 +149,7 @@ public:
             double          double_;
         } value_;
         Type            type_;
+        int             len_;  // for tCHARS and tWCHARS the length if known or -1, in what would be padding
     };
 
 protected:
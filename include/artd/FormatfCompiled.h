@@ -0,0 +1,496 @@
+/*-
+ * Copyright (c) 1991-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ * 
+ *  $Id$
+ */
+
+#ifndef __artd_FormatfCompiled_h
+#define __artd_FormatfCompiled_h
+
+#include "artd/FormatfSink.h"
+#include "artd/RcString.h"
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#define INL ARTD_ALWAYS_INLINE
+
+ARTD_BEGIN
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+
+#define ARTD_HAS_COMPILED_FORMAT 1
+
+/**
+ * A format string literal as a template argument, see ARTD_FMT()
+ */
+template<int N>
+struct FormatfLiteral
+{
+	consteval FormatfLiteral(const char (&s)[N]) {
+		for(int i = 0; i < N; ++i) {
+			chars_[i] = s[i];
+		}
+	}
+	char chars_[N];
+};
+
+// these are never defined, they are called from the format parser when it is
+// run by the compiler so the error message names the problem.
+void ARTD_FMT_invalid_conversion_spec();
+void ARTD_FMT_percent_n_not_supported();
+void ARTD_FMT_format_ends_in_percent();
+
+/**
+ * A format string parsed by the compiler.  The text between conversions is
+ * copied in blocks and simple conversions (%d, %i, %u, %s, %c with no flags,
+ * width or precision) are written straight from the argument's type without
+ * going through FormatfStream.  Conversions with flags, width or precision
+ * are handed to FormatfStream individually so the output is the same as
+ * RcString::format() for the same format and arguments, except that as the
+ * argument types are known integers are never truncated to the size given
+ * by the conversion, ie: an int64_t for "%d" is written in full.
+ *
+ * The number of arguments and their types are checked against the
+ * conversions at compile time, ie: a double passed for a "%s" will not
+ * compile.
+ *
+ * The formats are "char" utf8 strings, %n is not supported.
+ *
+ *   RcString s = RcString::format(ARTD_FMT("%s has %d items"), name, count);
+ */
+template<FormatfLiteral Fmt>
+class FormatfCompiled
+{
+public:
+	typedef void CompiledFormatTag;
+
+	// class of an argument, for matching them to conversions
+	enum {
+		acINT,
+		acUINT,
+		acCHAR,
+		acBOOL,
+		acREAL,
+		acCHARS,
+		acWCHARS,
+		acRCSTR,
+		acOBJECT,
+		acPOINTER,
+	};
+
+private:
+
+	static constexpr int FmtLen = sizeof(Fmt.chars_) - 1;
+
+	struct Piece
+	{
+		int litStart = 0;    // literal text before the conversion
+		int litLen = 0;
+		int specStart = 0;   // the conversion in the format ie: "%-8.3f"
+		int specLen = 0;
+		int textOffset = 0;  // of the null terminated copy of the spec in specText_
+		int argIndex = 0;    // first argument used including any '*' width and precision
+		int argCount = 0;
+		char conv = 0;       // 0 if only literal text
+		bool plain = false;  // no flags, width or precision
+	};
+
+	struct Parsed
+	{
+		int pieceCount = 0;
+		int argCount = 0;
+		int specTextLen = 0;
+	};
+
+	static constexpr bool isFlag(char c) {
+		return(c == '-' || c == '+' || c == ' ' || c == '#' || c == '0');
+	}
+	static constexpr bool isDigit(char c) {
+		return(c >= '0' && c <= '9');
+	}
+
+	/** @brief parses the conversion at '%' in the format, returns index after it */
+	static consteval int parseSpec(int i, Piece &p) {
+		const char *s = Fmt.chars_;
+		bool flags = false;
+		bool minusOnly = true;
+		bool width = false;
+		bool precis = false;
+		int stars = 0;
+
+		p.specStart = i++;
+		while(isFlag(s[i])) {
+			flags = true;
+			if(s[i] != '-') {
+				minusOnly = false;
+			}
+			++i;
+		}
+		if(s[i] == '*') {
+			width = true;
+			++stars;
+			++i;
+		} else {
+			while(isDigit(s[i])) {
+				width = true;
+				++i;
+			}
+		}
+		if(s[i] == '.') {
+			precis = true;
+			++i;
+			if(s[i] == '*') {
+				++stars;
+				++i;
+			} else {
+				while(isDigit(s[i])) {
+					++i;
+				}
+			}
+		}
+		if(s[i] == 'h') {
+			++i;
+		} else if(s[i] == 'l' || s[i] == 'L') {
+			if(s[i + 1] == s[i]) {
+				++i;
+			}
+			++i;
+		}
+		const char c = s[i];
+		switch(c) {
+			case 'c':
+				if(!minusOnly || precis) {
+					ARTD_FMT_invalid_conversion_spec();
+				}
+				break;
+			case 's': case 'S': case 't': case 'w':
+				if(!minusOnly) {
+					ARTD_FMT_invalid_conversion_spec();
+				}
+				break;
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'b':
+			case 'p': case 'f': case 'e': case 'E': case 'g': case 'G':
+				break;
+			case 'n':
+				ARTD_FMT_percent_n_not_supported();
+				break;
+			case 0:
+				ARTD_FMT_format_ends_in_percent();
+				break;
+			default:
+				ARTD_FMT_invalid_conversion_spec();
+				break;
+		}
+		p.conv = c;
+		p.plain = !flags && !width && !precis;
+		p.argCount = stars + 1;
+		p.specLen = i + 1 - p.specStart;
+		return(i + 1);
+	}
+
+	/** @brief parses the format into pieces, out may be null to only count them */
+	static consteval Parsed parse(Piece *out) {
+		const char *s = Fmt.chars_;
+		Parsed r;
+		Piece p;
+		int i = 0;
+		p.litStart = 0;
+		while(i < FmtLen) {
+			if(s[i] != '%') {
+				++i;
+				continue;
+			}
+			if(s[i + 1] == '%') {
+				// "%%" ends the literal after the first '%' and skips the second
+				p.litLen = i + 1 - p.litStart;
+				if(out) {
+					out[r.pieceCount] = p;
+				}
+				++r.pieceCount;
+				p = Piece();
+				i += 2;
+				p.litStart = i;
+				continue;
+			}
+			p.litLen = i - p.litStart;
+			i = parseSpec(i, p);
+			p.argIndex = r.argCount;
+			p.textOffset = r.specTextLen;
+			r.argCount += p.argCount;
+			r.specTextLen += p.specLen + 1;
+			if(out) {
+				out[r.pieceCount] = p;
+			}
+			++r.pieceCount;
+			p = Piece();
+			p.litStart = i;
+		}
+		if(i > p.litStart) {
+			p.litLen = i - p.litStart;
+			if(out) {
+				out[r.pieceCount] = p;
+			}
+			++r.pieceCount;
+		}
+		return(r);
+	}
+
+	static constexpr Parsed parsed_ = parse(nullptr);
+
+	template<int N>
+	struct PieceArray
+	{
+		Piece p[N > 0 ? N : 1];
+	};
+	static consteval PieceArray<parsed_.pieceCount> makePieces() {
+		PieceArray<parsed_.pieceCount> a;
+		parse(a.p);
+		return(a);
+	}
+	static constexpr PieceArray<parsed_.pieceCount> pieces_ = makePieces();
+
+	template<int N>
+	struct CharArray
+	{
+		char c[N > 0 ? N : 1];
+	};
+	static consteval CharArray<parsed_.specTextLen> makeSpecText() {
+		CharArray<parsed_.specTextLen> a = {};
+		for(int i = 0; i < parsed_.pieceCount; ++i) {
+			const Piece &p = pieces_.p[i];
+			if(p.conv) {
+				for(int j = 0; j < p.specLen; ++j) {
+					a.c[p.textOffset + j] = Fmt.chars_[p.specStart + j];
+				}
+				a.c[p.textOffset + p.specLen] = 0;
+			}
+		}
+		return(a);
+	}
+	static constexpr CharArray<parsed_.specTextLen> specText_ = makeSpecText();
+
+	static constexpr int mask(int ac) { return(1 << ac); }
+
+	/** @brief mask of the argument classes the conversion accepts */
+	static constexpr int accepts(char conv) {
+		switch(conv) {
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'b': case 'c':
+				return(mask(acINT) | mask(acUINT) | mask(acCHAR));
+			case 'f': case 'e': case 'E': case 'g': case 'G':
+				return(mask(acREAL));
+			case 's': case 'S': case 't': case 'w':
+				return(mask(acCHARS) | mask(acWCHARS) | mask(acBOOL) | mask(acRCSTR) | mask(acOBJECT));
+			case 'p':
+				return(mask(acPOINTER) | mask(acCHARS) | mask(acWCHARS));
+			default:
+				return(0);
+		}
+	}
+
+public:
+
+	/** @brief number of arguments the format takes */
+	static constexpr int ArgCount = parsed_.argCount;
+
+	/** @brief the class of argument type T, as FormatfArgBase::Arg would load it */
+	template<class T>
+	static constexpr int argClass() {
+		typedef std::remove_cv_t<std::remove_reference_t<T>> D;
+		typedef std::decay_t<D> P;
+		if constexpr(std::is_same_v<D, bool>) {
+			return(acBOOL);
+		} else if constexpr(std::is_same_v<D, char> || std::is_same_v<D, wchar_t>) {
+			return(acCHAR);
+		} else if constexpr(std::is_integral_v<D>) {
+			return(std::is_signed_v<D> ? acINT : acUINT);
+		} else if constexpr(std::is_floating_point_v<D>) {
+			return(acREAL);
+		} else if constexpr(std::is_same_v<P, const char *> || std::is_same_v<P, char *>
+							|| std::is_base_of_v<std::string_view, D> || std::is_same_v<D, string_arg<char>>
+							|| std::is_same_v<D, std::string>) {
+			return(acCHARS);
+		} else if constexpr(std::is_same_v<P, const wchar_t *> || std::is_same_v<P, wchar_t *>
+							|| std::is_base_of_v<std::wstring_view, D> || std::is_same_v<D, string_arg<wchar_t>>
+							|| std::is_same_v<D, std::wstring>) {
+			return(acWCHARS);
+		} else if constexpr(std::is_base_of_v<RcString, D> || std::is_base_of_v<RcWString, D>) {
+			return(acRCSTR);
+		} else if constexpr(std::is_pointer_v<P> || std::is_same_v<D, std::nullptr_t>) {
+			return(acPOINTER);
+		} else {
+			return(acOBJECT); // ObjectPtr<> or a class with toString()
+		}
+	}
+
+	/** @brief true if the argument types match the conversions */
+	template<class... Args>
+	static constexpr bool argsMatch() {
+		const int classes[sizeof...(Args) + 1] = { argClass<Args>()..., 0 };
+		if((int)sizeof...(Args) != ArgCount) {
+			return(false);
+		}
+		for(int i = 0; i < parsed_.pieceCount; ++i) {
+			const Piece &p = pieces_.p[i];
+			if(!p.conv) {
+				continue;
+			}
+			const int last = p.argIndex + p.argCount - 1;
+			for(int a = p.argIndex; a < last; ++a) {
+				// '*' width or precision
+				if(!(mask(classes[a]) & (mask(acINT) | mask(acUINT) | mask(acCHAR)))) {
+					return(false);
+				}
+			}
+			if(!(mask(classes[last]) & accepts(p.conv))) {
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/** @brief formats the arguments into out */
+	template<class... Args>
+	INL static void write(FormatfBuffer &out, const Args &... args) {
+		static_assert((int)sizeof...(Args) == ArgCount, "ARTD_FMT: wrong number of arguments for the format");
+		static_assert(argsMatch<Args...>(), "ARTD_FMT: an argument type does not match its conversion");
+		writePieces(out, std::tuple<const Args &...>(args...), std::make_index_sequence<parsed_.pieceCount>());
+	}
+
+	/** @brief formats the arguments into a new RcString or RcWString */
+	template<class SubT = RcString, class... Args>
+	static SubT format(const Args &... args) {
+		FormatfBuffer out;
+		write(out, args...);
+		if constexpr(sizeof(typename SubT::CharT) == sizeof(char)) {
+			return(SubT::createForSize(out.length(), out.data()));
+		} else {
+			return(SubT(out.c_str()));
+		}
+	}
+
+	/** @brief formats the arguments to a sink, returns the number of bytes written */
+	template<class... Args>
+	static int writeTo(FormatfSink &sink, const Args &... args) {
+		FormatfBuffer out;
+		write(out, args...);
+		sink.write(out.data(), out.length());
+		return(out.length());
+	}
+
+	/**
+	 * @brief formats into out, writing at most maxchars - 1 chars and a null
+	 * as FormatfStreamBase::sprintf() does.  returns the number of chars written.
+	 */
+	template<class... Args>
+	static int sprintf(char *out, int maxchars, const Args &... args) {
+		FormatfBuffer buf;
+		write(buf, args...);
+		return(buf.copyTo(out, maxchars));
+	}
+
+private:
+
+	template<class Tuple, size_t... I>
+	INL static void writePieces(FormatfBuffer &out, const Tuple &args, std::index_sequence<I...>) {
+		(writePiece<I>(out, args), ...);
+	}
+
+	template<size_t I, class Tuple>
+	INL static void writePiece(FormatfBuffer &out, const Tuple &args) {
+		constexpr Piece p = pieces_.p[I];
+		if constexpr(p.litLen > 0) {
+			out.append(Fmt.chars_ + p.litStart, p.litLen);
+		}
+		if constexpr(p.conv != 0) {
+			typedef std::remove_cv_t<std::remove_reference_t<std::tuple_element_t<p.argIndex, Tuple>>> ArgT;
+			const ArgT &arg = std::get<p.argIndex>(args);
+			constexpr int ac = argClass<ArgT>();
+
+			if constexpr(p.plain && (p.conv == 'd' || p.conv == 'i') && (ac == acINT || ac == acCHAR)) {
+				out.appendInt((int64_t)arg);
+			} else if constexpr(p.plain && (p.conv == 'd' || p.conv == 'i' || p.conv == 'u') && ac == acUINT) {
+				out.appendUInt((uint64_t)arg);
+			} else if constexpr(p.plain && p.conv == 'c' && std::is_same_v<ArgT, char>) {
+				out.append(arg);
+			} else if constexpr(p.plain && p.conv != 'p' && ac == acCHARS) {
+				if constexpr(std::is_pointer_v<std::decay_t<ArgT>>) {
+					out.appendChars(arg);
+				} else if constexpr(std::is_same_v<ArgT, string_arg<char>>) {
+					if(arg.c_str()) {
+						out.append(arg.c_str(), arg.length());
+					} else {
+						out.appendChars(nullptr);
+					}
+				} else {
+					out.append(arg.data(), (int)arg.size());
+				}
+			} else if constexpr(p.plain && p.conv != 'p' && std::is_base_of_v<RcString, ArgT>) {
+				if(arg) {
+					out.append(arg.c_str(), arg.length());
+				} else {
+					out.appendChars(nullptr);
+				}
+			} else {
+				writeFormatted<p.argIndex>(out, specText_.c + p.textOffset, args, std::make_index_sequence<p.argCount>());
+			}
+		}
+	}
+
+	/** integers as the int or 64 bit types FormatfArgBase::Arg loads, ie: short as int */
+	template<class T>
+	INL static decltype(auto) argFor(const T &v) {
+		if constexpr(std::is_integral_v<T> && argClass<T>() != acBOOL && argClass<T>() != acCHAR) {
+			if constexpr(sizeof(T) <= sizeof(int)) {
+				typedef std::conditional_t<std::is_signed_v<T>, int, unsigned int> W;
+				return(W(v));
+			} else {
+				typedef std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t> W;
+				return(W(v));
+			}
+		} else {
+			return((v));
+		}
+	}
+
+	template<size_t First, class Tuple, size_t... K>
+	static void writeFormatted(FormatfBuffer &out, const char *spec, const Tuple &args, std::index_sequence<K...>) {
+		FormatfArglist<sizeof...(K)> arglist;
+		FormatfArgBase::addArgs(arglist.args(), argFor(std::get<First + K>(args))...);
+		out.appendFormatted(spec, arglist);
+	}
+};
+
+/**
+ * A format string literal checked and parsed at compile time, for
+ * RcString::format(ARTD_FMT("..."), args...), see FormatfCompiled.
+ */
+#define ARTD_FMT(fmt) (::artd::FormatfCompiled<fmt>())
+
+#endif // C++20
+
+ARTD_END
+
+#undef INL
+
+#endif // __artd_FormatfCompiled_h
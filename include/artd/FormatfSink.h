@@ -0,0 +1,225 @@
+/*-
+ * Copyright (c) 1991-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ * 
+ *  $Id$
+ */
+
+#ifndef __artd_FormatfSink_h
+#define __artd_FormatfSink_h
+
+#include "artd/Formatf.h"
+#include <cstring>
+#include <string>
+
+#define INL ARTD_ALWAYS_INLINE
+
+ARTD_BEGIN
+
+/**
+ * Destination for formatted output. FormatfStreamBase::writeTo() formats
+ * a whole stream into a sink in one pass, handing it utf8 in blocks, so
+ * nothing has to be measured first and output need not fit a fixed buffer.
+ *
+ *   FormatfFdSink out(fd);
+ *   out.printf("%s: %d\n", name, value);
+ */
+class ARTD_API_JLIB_BASE FormatfSink
+{
+public:
+	virtual ~FormatfSink();
+
+	/** @brief takes len bytes of utf8 output */
+	virtual void write(const char *utf8, int len) = 0;
+
+	/** @brief formats into this sink, returns the number of bytes written */
+	int vprintf(const char *fmt, const FormatfArglist<> &args);
+	int vprintf(const wchar_t *fmt, const FormatfArglist<> &args);
+
+	template <typename... Args>
+	INL int printf(const char *fmt, const Args &... args) {
+		FormatfArglist<sizeof...(Args)> arglist;
+		FormatfArglist<>::addArgs(arglist.args(), args...);
+		return(vprintf(fmt, arglist));
+	}
+	template <typename... Args>
+	INL int printf(const wchar_t *fmt, const Args &... args) {
+		FormatfArglist<sizeof...(Args)> arglist;
+		FormatfArglist<>::addArgs(arglist.args(), args...);
+		return(vprintf(fmt, arglist));
+	}
+};
+
+/**
+ * Growable in memory output buffer. Short output is held inline and longer
+ * output grows onto the heap.
+ */
+class ARTD_API_JLIB_BASE FormatfBuffer
+	: public FormatfSink
+{
+	FormatfBuffer(const FormatfBuffer &) = delete;
+	FormatfBuffer &operator=(const FormatfBuffer &) = delete;
+public:
+	INL FormatfBuffer()
+		: buf_(inline_)
+		, len_(0)
+		, cap_(sizeof(inline_))
+	{}
+	~FormatfBuffer();
+
+	void write(const char *utf8, int len) override;
+
+	INL void append(const char *chars, int len) {
+		if(len > cap_ - len_) {
+			grow(len);
+		}
+		::memcpy(buf_ + len_, chars, len);
+		len_ += len;
+	}
+	INL void append(char c) {
+		if(len_ >= cap_) {
+			grow(1);
+		}
+		buf_[len_++] = c;
+	}
+	void appendInt(int64_t val);
+	void appendUInt(uint64_t val);
+	/** @brief appends a null terminated string, "(nil)" for a null one as FormatfStream does */
+	void appendChars(const char *chars);
+	/** @brief appends a single conversion, ie: "%-8.3f", formatted by FormatfStream */
+	void appendFormatted(const char *spec, const FormatfArglist<> &args);
+
+	INL const char *data() const { return(buf_); }
+	INL int length() const { return(len_); }
+	INL void clear() { len_ = 0; }
+	/** @brief the output null terminated */
+	const char *c_str();
+	/**
+	 * @brief copies the output into out, truncating at a utf8 character boundary
+	 * to maxchars - 1 and null terminating, as FormatfStreamBase::sprintf() does.
+	 * returns the number of chars copied.
+	 */
+	int copyTo(char *out, int maxchars) const;
+
+private:
+	void grow(int needed);
+
+	char *buf_;
+	int len_;
+	int cap_;
+	char inline_[256];
+};
+
+/** appends output to a std::string */
+class ARTD_API_JLIB_BASE FormatfStringSink
+	: public FormatfSink
+{
+public:
+	INL explicit FormatfStringSink(std::string &out)
+		: out_(out)
+	{}
+	void write(const char *utf8, int len) override;
+
+private:
+	std::string &out_;
+};
+
+/**
+ * Buffered writer to a file descriptor, a file, pipe or socket. Output is
+ * written when the buffer fills, on flush() and when destroyed. The
+ * descriptor is not closed.
+ *
+ * Sockets are written with send() and MSG_NOSIGNAL where there is one, so
+ * a closed peer fails the sink rather than raising SIGPIPE. Writing to a
+ * pipe with no reader still raises it unless SIGPIPE is ignored.
+ *
+ * Output a non blocking descriptor won't take yet is kept, the buffer
+ * grows to hold it, and written by the next flush() or write().
+ */
+class ARTD_API_JLIB_BASE FormatfFdSink
+	: public FormatfSink
+{
+	FormatfFdSink(const FormatfFdSink &) = delete;
+	FormatfFdSink &operator=(const FormatfFdSink &) = delete;
+public:
+	explicit FormatfFdSink(int fd, int bufferSize = 4096);
+	~FormatfFdSink();
+
+	void write(const char *utf8, int len) override;
+
+	/**
+	 * @brief writes any buffered output, false if a write has failed or a
+	 * non blocking descriptor didn't take all of it, see pending()
+	 */
+	bool flush();
+	/** @brief true if a write to the descriptor has failed, later output is dropped */
+	INL bool failed() const { return(failed_); }
+	/** @brief bytes buffered and not yet written, ie: waiting for a non blocking socket */
+	INL int pending() const { return(used_); }
+
+private:
+	int writeFd(const char *data, int len);
+	void buffer(const char *data, int len);
+
+	int fd_;
+	char *buf_;
+	int used_;
+	int size_;
+	bool failed_;
+	bool notSocket_;
+};
+
+/**
+ * Keeps the most recent capacity bytes written, older output is dropped,
+ * ie: for a trace of recent log lines. The oldest retained output may start
+ * part way through a utf8 character.
+ */
+class ARTD_API_JLIB_BASE FormatfRingSink
+	: public FormatfSink
+{
+	FormatfRingSink(const FormatfRingSink &) = delete;
+	FormatfRingSink &operator=(const FormatfRingSink &) = delete;
+public:
+	explicit FormatfRingSink(int capacity);
+	~FormatfRingSink();
+
+	void write(const char *utf8, int len) override;
+
+	INL int capacity() const { return(cap_); }
+	/** @brief number of bytes held, at most capacity() */
+	INL int size() const { return(total_ < (uint64_t)cap_ ? (int)total_ : cap_); }
+	/** @brief total bytes ever written */
+	INL uint64_t totalWritten() const { return(total_); }
+	/** @brief copies up to maxbytes of the held output, oldest first, returns the count */
+	int copyTo(char *out, int maxbytes) const;
+	INL void clear() { total_ = 0; head_ = 0; }
+
+private:
+	char *buf_;
+	int cap_;
+	int head_;  // where the next byte goes
+	uint64_t total_;
+};
+
+ARTD_END
+
+#undef INL
+
+#endif // __artd_FormatfSink_h
@@ -0,0 +1,67 @@
+#ifndef __artd_MappedFile_h
+#define __artd_MappedFile_h
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#include "artd/RcArray.h"
+
+ARTD_BEGIN
+
+/**
+ * Maps files into memory as ByteArrays.
+ *
+ * The returned array's elements are the mapped pages of the file, not a
+ * copy, so nothing is read until it is touched and the page cache is
+ * shared with other mappings of the same file.  The mapping is owned by
+ * the array object and is unmapped when the last reference is released.
+ *
+ * Mappings are private, writing to the elements changes the in memory
+ * copy only and is never written back to the file.
+ *
+ * As array lengths are an int a single mapping is limited to 2GB, larger
+ * files can be mapped in windows with map(path, offset, length).
+ *
+ * path is utf8.  All the map() calls return a null array if the file can
+ * not be opened or mapped, and an empty array for an empty file or window.
+ */
+class ARTD_API_JLIB_BASE MappedFile
+{
+public:
+
+	/** @brief maps an entire file, null if it is larger than 2GB */
+	static ByteArray map(const char *path);
+
+	/**
+	 * @brief maps length bytes starting at offset in the file, the window is
+	 * clipped to the end of the file. Null if offset is past the end.
+	 */
+	static ByteArray map(const char *path, int64_t offset, int length);
+
+	/** @brief size of a file in bytes or -1 if it can not be opened */
+	static int64_t fileSize(const char *path);
+};
+
+ARTD_END
+
+#endif // __artd_MappedFile_h
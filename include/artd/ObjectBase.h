@@ -252,10 +252,13 @@ public:
 	size_t extraSize;
 	size_t allocatedSize = 0;
 	void* allocatedAt = nullptr;
+	/** if set the allocation is zero filled, large ones with fresh zero pages from calloc() */
+	bool zeroed;
 
     
-	INL ObjAllocatorArg(size_t extraSize = 0)
+	INL ObjAllocatorArg(size_t extraSize = 0, bool zeroed = false)
 		: extraSize(extraSize)
+		, zeroed(zeroed)
 	{
         prior_ = _allocatorArg_;
 		// TODO: check is this item is on the stack or not.
@@ -306,6 +309,15 @@ protected:
 	// and will deal it "embeded" inherited objects in a containing class
 	ObjectBase() : cbPtr(_allocatorArg_ != nullptr ? _allocatorArg_->allocatedAt : NOT_SHARED()) {}
 
+	/** tag for constant initialized static objects which are never freed and have no control block */
+	struct StaticObject {};
+	constexpr ObjectBase(StaticObject) : cbPtr(&initValues[0]) {}
+
+	/** @brief false for StaticObject and other objects not allocated with a shared control block */
+	INL bool hasControlBlock() const {
+		return(cbPtr != NOT_SHARED());
+	}
+
 	virtual const ArtdClass* getClass() const {
 		return(nullptr);
 	}
@@ -27,6 +27,9 @@
 
 #include "artd/ObjectBase.h"
 #include "artd/Logger.h"
+#include "artd/pointer_math.h"
+#include <cstring>
+#include <type_traits>
 
 
 ARTD_BEGIN
@@ -35,6 +38,23 @@ ARTD_BEGIN
 #pragma pack(push,4) // int alignment
 #define INL ARTD_ALWAYS_INLINE
 
+/**
+ * Supplies the memory blocks array objects are allocated in, for pools
+ * that recycle them, see ByteArrayPool.  A block holds the shared control
+ * block and the array object.  The source must outlive the arrays
+ * allocated from it.
+ */
+class ARTD_API_JLIB_BASE RcArrayBlockSource
+{
+public:
+	/** @brief a block of blockSize bytes, throws std::bad_alloc on failure */
+	virtual void *takeBlock(size_t blockSize) = 0;
+	/** @brief called on the last release of the array in block */
+	virtual void giveBlock(void *block, size_t blockSize) = 0;
+protected:
+	virtual ~RcArrayBlockSource() {}
+};
+
 /**
  * Reference counted Byte Array object
  */
@@ -43,34 +63,84 @@ class RcArrayBase
 {
 private:
 	friend class RcString;
+	friend class RcArrayHolder;
 
 protected:
 
-    ARTD_API_JLIB_BASE RcArrayBase(int len);
+    /** elements in the tail of this object at the first alignment boundary, a power of 2 */
+    ARTD_API_JLIB_BASE RcArrayBase(int len, int alignment = 1);
+    /** for subclasses whose elements are not in the tail of this object ie: a mapped file */
+    ARTD_API_JLIB_BASE RcArrayBase(int len, void *externalData);
     ARTD_API_JLIB_BASE virtual ~RcArrayBase() override;
+
+	/** the elements, normally the tail of this object */
+	void *data_;
+	/** alignment of the elements in the tail of this object or 0 if external */
+	int alignment_;
+
 public:
 
-	/** length of buffer in number of elements */
-	const int len_;
+	/**
+	 * length of buffer in number of elements, fixed once an array is created,
+	 * only an RcVector's buffer changes it as it grows in place.
+	 */
+	int len_;
 
 	INL static int offsetOfArray() { return(sizeof(RcArrayBase)); }
-	INL const void *data() const { return(((char *)this)+sizeof(*this)); }
-	INL void *data() { return(((char *)this)+sizeof(*this)); }
+	INL const void *data() const { return(data_); }
+	INL void *data() { return(data_); }
+	/** @brief true if the elements are the tail of this object and not external */
+	INL bool hasInlineData() const { return(alignment_ != 0); }
+	/** @brief boundary the elements were allocated on, 0 if they are external */
+	INL int alignment() const { return(alignment_); }
 
 	INL int length() const { return(len_); }
 	/** returns size of Array object in bytes for a specified number of bytes */
 	INL static size_t sizeForData(size_t byteSize) { return(offsetOfArray() + byteSize); }
 	INL static size_t sizeForElements(int count, int elemsize) { return(offsetOfArray() + (size_t)(elemsize * count)); }
 
-//    static ARTD_API_JLIB_BASE ObjectPtr<RcArrayBase> allocate(int numElems, int elemsize, bool clearIt);
-    static ARTD_API_JLIB_BASE ObjectPtr<RcArrayBase> allocate(int numElems, int elemSize);
+    /**
+     * allocates an array object with uninitialized elements or zero filled ones if clearIt is set,
+     * the elements start on an alignment boundary which must be a power of 2.
+     */
+    static ARTD_API_JLIB_BASE ObjectPtr<RcArrayBase> allocate(int numElems, int elemSize, bool clearIt, int alignment = 1);
+    INL static ObjectPtr<RcArrayBase> allocate(int numElems, int elemSize) {
+        return(allocate(numElems, elemSize, false));
+    }
+
+protected:
+    /** constructs the array object, a RcArrayBase or subclass of the same size, in mem */
+    typedef void (*ConstructFunc)(void *mem, int numElems, int alignment);
+
+    /**
+     * allocate() for subclasses, construct() creates the object in the allocated
+     * block and its virtual destructor is called on the last release.
+     */
+    static ARTD_API_JLIB_BASE ObjectPtr<RcArrayBase> allocateAs(int numElems, int elemSize, bool clearIt, int alignment, ConstructFunc construct);
+public:
+
+    /** @brief bytes needed in a block from an RcArrayBlockSource for an array of numElems */
+    static ARTD_API_JLIB_BASE size_t blockSizeFor(int numElems, int elemSize, int alignment = 1);
+
+    /**
+     * @brief allocate() in a block of blockSize bytes, at least blockSizeFor(), taken from source
+     * which gets the block back on the last release.  The block is zero filled if clearIt is set.
+     */
+    static ARTD_API_JLIB_BASE ObjectPtr<RcArrayBase> allocateFrom(RcArrayBlockSource *source, size_t blockSize,
+                                                                 int numElems, int elemSize, bool clearIt, int alignment = 1);
+
+	/** @brief true if both are null or have the same length and bytes, elemSize is the size of an element */
+	static ARTD_API_JLIB_BASE bool equals(const RcArrayBase *a, const RcArrayBase *b, int elemSize);
+	/** @brief compares byte arrays as unsigned bytes, shorter first if one is a prefix of the other and null first */
+	static ARTD_API_JLIB_BASE int compareBytes(const RcArrayBase *a, const RcArrayBase *b);
+	/** @brief StringAlgo::hash() of the elements bytes, 0 for null */
+	static ARTD_API_JLIB_BASE uint32_t hashBytes(const RcArrayBase *a, int elemSize);
 
 #if 0
 	static ARTD_API_JLIB_BASE RcArrayOwnedObjectBase *constructInstance(void *buf, int count, int elemsize, RefScope scope);
 	//** creates new object with refcount of 1 and array length of count for elemsize
 
 	static ARTD_API_JLIB_BASE RcArrayOwnedObjectBase *getStaticInstance(void *buf, int count, int elemsize);
-	static ARTD_API_JLIB_BASE int equals(const RcArrayOwnedObjectBase *a, const RcArrayOwnedObjectBase *b);
 	ARTD_API_JLIB_BASE bool isAllocated();
 
     ARTD_API_JLIB_BASE RcArrayOwnedObjectBase *ensureAllocated(int elemsize);
@@ -92,36 +162,149 @@ public:
 
     friend class RcArrayImpl;
     friend class RcArrayBase;
+    template<class> friend class RcVector;
 
     static const int OffsetOfElements = sizeof(RcArrayBase);
 
     INL ElemT *elements() { return(reinterpret_cast<ElemT *>(BaseT::data())); }
     INL const ElemT *elements() const { return(reinterpret_cast<const ElemT *>(BaseT::data())); }
 
+    /**
+     * elements() with the compiler told they are aligned on an Align byte boundary,
+     * only valid for arrays allocated with at least that alignment.
+     */
+    template<int Align>
+    INL ElemT *alignedElements() { return(assumeAligned<Align>(elements())); }
+    template<int Align>
+    INL const ElemT *alignedElements() const { return(assumeAligned<Align>(elements())); }
+
     INL size_t dataSize() const { return(BaseT::len_ * sizeof(ElemT)); }
 
-    static ObjectPtr<RcArrayObj<ElemT>> createInstance(int count) {
-        ObjectPtr<RcArrayBase> newOne = RcArrayBase::allocate(count, sizeof(ElemT));
-        ElemT* pelem = reinterpret_cast<ElemT *>(newOne->data());
+    /**
+     * elements are value initialized, zero for primitives.
+     * alignment is a power of 2 and at least alignof(ElemT).
+     */
+    static ObjectPtr<RcArrayObj<ElemT>> createInstance(int count, int alignment = alignof(ElemT)) {
+        if constexpr (std::is_trivially_default_constructible<ElemT>::value) {
+            // zero filled by the allocator, large arrays get untouched zero pages
+            return(cast(allocateObj(count, true, alignment)));
+        } else {
+            return(constructEach(allocateObj(count, false, alignment), count,
+                                 [](ElemT *pelem, int) { new(pelem) ElemT(); })); // default constructor
+        }
+    }
+
+    /** elements are default initialized, for primitives that is left uninitialized */
+    static ObjectPtr<RcArrayObj<ElemT>> createUninitialized(int count, int alignment = alignof(ElemT)) {
+        if constexpr (!std::is_trivially_default_constructible<ElemT>::value) {
+            return(constructEach(allocateObj(count, false, alignment), count,
+                                 [](ElemT *pelem, int) { new(pelem) ElemT; }));
+        } else {
+            return(cast(allocateObj(count, false, alignment)));
+        }
+    }
 
-        // TODO: do nothiing here if it is a primitive or has no constructor ?
-        const ElemT* maxElem = pelem + count;
-        while (pelem < maxElem) {
-            new(pelem) ElemT(); // default constructor
-            ++pelem;
+    /** elements are copies of the count elements at src */
+    static ObjectPtr<RcArrayObj<ElemT>> createCopy(const ElemT *src, int count, int alignment = alignof(ElemT)) {
+        if constexpr (std::is_trivially_copyable<ElemT>::value) {
+            ObjectPtr<RcArrayBase> newOne = allocateObj(count, false, alignment);
+            ::memcpy(newOne->data(), src, count * sizeof(ElemT));
+            return(cast(std::move(newOne)));
+        } else {
+            return(constructEach(allocateObj(count, false, alignment), count,
+                                 [src](ElemT *pelem, int i) { new(pelem) ElemT(src[i]); }));
         }
-        return(*reinterpret_cast<ObjectPtr<RcArrayObj<ElemT>> *>(&newOne));
+    }
+
+    /** @brief the handle to an array allocated as RcArrayObj<ElemT>, ie: by RcArrayBase::allocateFrom() */
+    INL static ObjectPtr<RcArrayObj<ElemT>> cast(ObjectPtr<RcArrayBase> &&h) {
+        return(std::move(*reinterpret_cast<ObjectPtr<RcArrayObj<ElemT>> *>(&h)));
     }
 
 protected:
+    /**
+     * constructs the count elements of a new array with ctor(pelem, index).
+     * len_ counts the ones constructed so if one throws releasing the array
+     * destroys only those.
+     */
+    template<class CtorT>
+    static ObjectPtr<RcArrayObj<ElemT>> constructEach(ObjectPtr<RcArrayBase> &&newOne, int count, CtorT ctor) {
+        ObjectPtr<RcArrayObj<ElemT>> obj = cast(std::move(newOne));
+        ElemT *pelem = obj->elements();
+        obj->len_ = 0;
+        while (obj->len_ < count) {
+            ctor(pelem + obj->len_, obj->len_);
+            ++obj->len_;
+        }
+        return(obj);
+    }
+    template<int Align, class T>
+    INL static T *assumeAligned(T *p) {
+    #if defined(__GNUC__) || defined(__clang__)
+        return(static_cast<T *>(__builtin_assume_aligned(p, Align)));
+    #else
+        return(p);
+    #endif
+    }
+    static void construct(void *mem, int count, int alignment) {
+        ::new(mem) RcArrayObj<ElemT>(count, alignment);
+    }
+    INL static ObjectPtr<RcArrayBase> allocateObj(int count, bool clearIt, int alignment) {
+        if (alignment < (int)alignof(ElemT)) {
+            alignment = alignof(ElemT);
+        }
+        return(RcArrayBase::allocateAs(count, sizeof(ElemT), clearIt, alignment, &construct));
+    }
+    static void constructEmpty(void *mem, int /*capacity*/, int alignment) {
+        ::new(mem) RcArrayObj<ElemT>(0, alignment);
+    }
+    /** room for capacity elements with a length of 0, for RcVector */
+    INL static ObjectPtr<RcArrayObj<ElemT>> allocateEmpty(int capacity) {
+        return(cast(RcArrayBase::allocateAs(capacity, sizeof(ElemT), false, alignof(ElemT), &constructEmpty)));
+    }
+
     // Can't create these directly as they vary in size
     RcArrayObj() {}
+    RcArrayObj(int count, int alignment) : RcArrayBase(count, alignment) {}
+    RcArrayObj(int count, ElemT *externalElements) : RcArrayBase(count, externalElements) {}
+
+    /**
+     * destroys the elements in the tail of this object, this costs nothing for trivially
+     * destructible types. Subclasses with external elements own their lifetime.
+     */
+    ~RcArrayObj() override {
+        if constexpr (!std::is_trivially_destructible<ElemT>::value) {
+            if (BaseT::hasInlineData()) {
+                ElemT* pelem = elements() + BaseT::len_;
+                while (pelem > elements()) {
+                    (--pelem)->~ElemT();
+                }
+            }
+        }
+    }
 //    RcArrayObj(const RcArrayObj &r) {}
 //    RcArrayObj(RcArrayObj &&r) {}
 //    RcArrayObj(int len) : super(len) { }
 };
 
 
+/**
+ * Array object whose elements are part of another array object, ie: a
+ * mapped file, which it holds a reference to so they stay valid.
+ */
+template <class ElemT>
+class RcSubArrayObj
+    : public RcArrayObj<ElemT>
+{
+    ObjectPtr<RcArrayBase> owner_;
+public:
+    RcSubArrayObj(const ObjectPtr<RcArrayBase> &owner, ElemT *elements, int count)
+        : RcArrayObj<ElemT>(count, elements)
+        , owner_(owner)
+    {}
+};
+
+
 template<class ElemT>
 class PRcArray;
 
@@ -148,12 +331,34 @@ public:
     INL RcArray() {}
     INL RcArray(std::nullptr_t) : super() {}
     
+    /** array of numElems value initialized elements, zero for primitives */
     RcArray(int numElems) : super(ObjT::createInstance(numElems)) {
     }
 
-//    RcArray(const ElemT *elems, int numElems) {
-//        super::p_ = (RcArrayObj<ElemT>*)RcArrayBase::allocate(numElems, sizeof(ElemT),elems);
-//    }
+    /** array of copies of numElems elements */
+    RcArray(const ElemT *elems, int numElems) : super(ObjT::createCopy(elems, numElems)) {
+    }
+
+    /** array of numElems default initialized elements, for primitives that is not initialized */
+    INL static ThisT uninitialized(int numElems, int alignment = alignof(ElemT)) {
+        return(ThisT(ObjT::createUninitialized(numElems, alignment)));
+    }
+
+    /**
+     * array of count elements at elements which are part of the array object owner,
+     * no elements are copied and owner is kept until the returned array is released.
+     */
+    INL static ThisT subArray(const ObjectPtr<RcArrayBase> &owner, ElemT *elements, int count) {
+        return(ThisT(ObjectPtr<ObjT>(ObjectBase::make<RcSubArrayObj<ElemT>>(owner, elements, count))));
+    }
+
+    /**
+     * array of numElems value initialized elements starting on an alignment boundary,
+     * ie: 32 or 64 for avx kernels, alignment must be a power of 2.
+     */
+    INL static ThisT aligned(int numElems, int alignment) {
+        return(ThisT(ObjT::createInstance(numElems, alignment)));
+    }
 
     INL RcArray(const super &r) : super(r) {}
     INL RcArray(const ThisT &r) : super(r) {}
@@ -172,6 +377,34 @@ public:
 
 	INL ElemT *elements() { return((ElemT *)(super::get()->data())); }
 	INL const ElemT *elements() const { return((ElemT *)(super::get()->data())); }
+
+    /**
+     * @brief true if this is the only handle to the array object and it owns
+     * its elements. A sub array or one over external elements is shared with
+     * whatever owns them.
+     */
+    INL bool isUnique() const { return(super::use_count() == 1 && super::get()->hasInlineData()); }
+
+    /**
+     * @brief elements that may be modified in place, copy on write.
+     * If the array is shared it is first replaced by a copy, with the same
+     * alignment, that only this handle references.  Null if this is null.
+     */
+    ElemT *mutableElements() {
+        if (!super::get()) {
+            return(nullptr);
+        }
+        if (!isUnique()) {
+            int alignment = super::get()->alignment();
+            super::operator=(ObjT::createCopy(elements(), length(), alignment ? alignment : (int)alignof(ElemT)));
+        }
+        return(elements());
+    }
+    /** elements() assumed aligned to Align bytes, see RcArray::aligned() */
+    template<int Align>
+    INL ElemT *alignedElements() { return(super::get()->template alignedElements<Align>()); }
+    template<int Align>
+    INL const ElemT *alignedElements() const { return(super::get()->template alignedElements<Align>()); }
     INL int length() const { return(super::get()->len_); }
 
     INL ElemT &operator[](int ix) { return(((ElemT *)(super::get()->data()))[ix]); }
@@ -181,7 +414,66 @@ public:
     INL void  *data() { return(super::get()->data()); }
     INL size_t dataSize() { return(super::length() * sizeof(ElemT)); }
 
-    INL int equals(const ThisT &b) const { return(super::equals(b)); }
+    /**
+     * @brief true if both are null or have equal elements. Types whose values
+     * are their bytes are compared with memcmp(), others with ==.
+     */
+    bool equals(const ThisT &b) const {
+        if constexpr (std::has_unique_object_representations<ElemT>::value) {
+            return(RcArrayBase::equals(super::get(), b.get(), sizeof(ElemT)));
+        } else {
+            if (super::get() == b.get()) {
+                return(true);
+            }
+            if (!super::get() || !b.get() || length() != b.length()) {
+                return(false);
+            }
+            const ElemT *pa = elements();
+            const ElemT *pb = b.elements();
+            for (int i = 0; i < length(); ++i) {
+                if (!(pa[i] == pb[i])) {
+                    return(false);
+                }
+            }
+            return(true);
+        }
+    }
+
+    /**
+     * @brief lexicographic compare returning < 0, 0, > 0, null is first.
+     * Single byte unsigned types are compared with memcmp(), others with <.
+     */
+    int compare(const ThisT &b) const {
+        if constexpr (sizeof(ElemT) == 1 && std::is_unsigned<ElemT>::value) {
+            return(RcArrayBase::compareBytes(super::get(), b.get()));
+        } else {
+            if (super::get() == b.get()) {
+                return(0);
+            }
+            if (!super::get() || !b.get()) {
+                return(super::get() ? 1 : -1);
+            }
+            const ElemT *pa = elements();
+            const ElemT *pb = b.elements();
+            const int len = length() < b.length() ? length() : b.length();
+            for (int i = 0; i < len; ++i) {
+                if (pa[i] < pb[i]) {
+                    return(-1);
+                }
+                if (pb[i] < pa[i]) {
+                    return(1);
+                }
+            }
+            return(length() - b.length());
+        }
+    }
+
+    /** @brief hash of the element bytes, for types whose values are their bytes */
+    INL uint32_t hashCode() const {
+        static_assert(std::has_unique_object_representations<ElemT>::value,
+                      "RcArray::hashCode() needs elements whose bytes are their value");
+        return(RcArrayBase::hashBytes(super::get(), sizeof(ElemT)));
+    }
 };
 
 
@@ -228,6 +520,35 @@ typedef RcArray<uint8_t> ByteArray;
 
 ARTD_END
 
-#endif // __artd_RcArray_h
+// content comparison and hashing for maps keyed on arrays, ie: std::unordered_map<ByteArray,...>
+// note operator== on the handles still compares identity.
+
+namespace std {
+
+template<class ElemT>
+struct hash<artd::RcArray<ElemT>>
+{
+    size_t operator()(const artd::RcArray<ElemT> &a) const {
+        return(a.hashCode());
+    }
+};
+
+template<class ElemT>
+struct equal_to<artd::RcArray<ElemT>>
+{
+    bool operator()(const artd::RcArray<ElemT> &a, const artd::RcArray<ElemT> &b) const {
+        return(a.equals(b));
+    }
+};
+
+template<class ElemT>
+struct less<artd::RcArray<ElemT>>
+{
+    bool operator()(const artd::RcArray<ElemT> &a, const artd::RcArray<ElemT> &b) const {
+        return(a.compare(b) < 0);
+    }
+};
 
+} // namespace std
 
+#endif // __artd_RcArray_h
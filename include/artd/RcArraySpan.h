@@ -0,0 +1,139 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#ifndef __artd_RcArraySpan_h
+#define __artd_RcArraySpan_h
+
+#include "artd/RcArray.h"
+#include "artd/artd_assert.h"
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+	#include <span>
+	#define ARTD_HAS_STD_SPAN 1
+#endif
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * A range of the elements of an RcArray which holds a reference to the array.
+ *
+ * Slicing a span only adjusts its offset and length so segments of one buffer,
+ * ie: the payloads in a received ByteArray, can be handed out without copying
+ * them and the buffer is freed when the last span or array referencing it is
+ * released.  Element access is bounds checked with ARTD_ASSERT.
+ */
+template<class ElemT>
+class RcArraySpan
+{
+	typedef RcArraySpan<ElemT> ThisT;
+
+	RcArray<ElemT> array_;
+	int offset_ = 0;
+	int length_ = 0;
+
+public:
+
+	INL RcArraySpan() {}
+	INL RcArraySpan(std::nullptr_t) {}
+
+	/** @brief span of all of an array */
+	INL RcArraySpan(const RcArray<ElemT> &array)
+		: array_(array)
+		, length_(array ? array.length() : 0)
+	{}
+	INL RcArraySpan(RcArray<ElemT> &&array)
+		: array_(std::move(array))
+		, length_(array_ ? array_.length() : 0)
+	{}
+	/** @brief span of length elements of an array starting at offset */
+	INL RcArraySpan(const RcArray<ElemT> &array, int offset, int length)
+		: array_(array)
+		, offset_(offset)
+		, length_(length)
+	{
+		ARTD_ASSERT(offset >= 0 && length >= 0 && (array ? array.length() : 0) - offset >= length);
+	}
+
+	INL int size() const { return(length_); }
+	INL int length() const { return(length_); }
+	INL bool empty() const { return(length_ == 0); }
+	INL size_t dataSize() const { return(length_ * sizeof(ElemT)); }
+
+	/** @brief the array this is a span of, may be null if this is empty */
+	INL const RcArray<ElemT> &array() const { return(array_); }
+	INL int offset() const { return(offset_); }
+
+	INL ElemT *data() { return(array_ ? array_.elements() + offset_ : nullptr); }
+	INL const ElemT *data() const { return(array_ ? array_.elements() + offset_ : nullptr); }
+
+	INL ElemT &operator[](int ix) {
+		ARTD_ASSERT((unsigned int)ix < (unsigned int)length_);
+		return(array_.elements()[offset_ + ix]);
+	}
+	INL const ElemT &operator[](int ix) const {
+		ARTD_ASSERT((unsigned int)ix < (unsigned int)length_);
+		return(array_.elements()[offset_ + ix]);
+	}
+
+	INL ElemT *begin() { return(data()); }
+	INL ElemT *end() { return(data() + length_); }
+	INL const ElemT *begin() const { return(data()); }
+	INL const ElemT *end() const { return(data() + length_); }
+
+	/** @brief span of length elements of this one starting at offset, O(1) */
+	INL ThisT slice(int offset, int length) const {
+		ARTD_ASSERT(offset >= 0 && length >= 0 && length_ - offset >= length);
+		ThisT s;
+		s.array_ = array_;
+		s.offset_ = offset_ + offset;
+		s.length_ = length;
+		return(s);
+	}
+	/** @brief the rest of this span starting at offset */
+	INL ThisT slice(int offset) const {
+		return(slice(offset, length_ - offset));
+	}
+	INL ThisT first(int count) const { return(slice(0, count)); }
+	INL ThisT last(int count) const { return(slice(length_ - count, count)); }
+
+	/** @brief a new array with copies of the elements in this span */
+	RcArray<ElemT> toArray() const {
+		return(RcArray<ElemT>(data(), length_));
+	}
+
+#ifdef ARTD_HAS_STD_SPAN
+	INL operator std::span<ElemT>() { return(std::span<ElemT>(data(), (size_t)length_)); }
+	INL operator std::span<const ElemT>() const { return(std::span<const ElemT>(data(), (size_t)length_)); }
+#endif
+};
+
+typedef RcArraySpan<uint8_t> ByteSpan;
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_RcArraySpan_h
@@ -0,0 +1,255 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#ifndef __artd_RcNdView_h
+#define __artd_RcNdView_h
+
+#include "artd/RcArray.h"
+#include "artd/artd_assert.h"
+#include <cstddef>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * N dimensional strided view of the elements of an RcArray, which it holds
+ * a reference to, ie: a matrix or an image in an RcArray<float> or ByteArray.
+ *
+ * shape(d) is the extent of dimension d and stride(d) the distance in
+ * elements between neighbours in it, the last dimension varies fastest in
+ * a view made from an array.  transpose(), permute(), slice(), index() and
+ * broadcast() return new views of the same elements without copying.
+ *
+ * Element addresses are base + sum(i[d] * stride(d)) so typed access is
+ * pointer arithmetic.  isContiguous() detects views whose elements are a
+ * dense row major block so kernels can run a flat loop over data() and
+ * size().  forEach() runs the innermost dimension as a pointer loop.
+ * Indices are checked with ARTD_ASSERT.
+ */
+template<class ElemT, int N>
+class RcNdView
+{
+	static_assert(N >= 1, "RcNdView needs at least one dimension");
+
+	template<class, int> friend class RcNdView;
+	typedef RcNdView<ElemT, N> ThisT;
+
+	RcArray<ElemT> array_;
+	ElemT *base_ = nullptr;
+	int shape_[N] = {};
+	ptrdiff_t strides_[N] = {};
+
+	template<class FuncT>
+	void forEachFrom(int dim, ElemT *p, FuncT &fn) const { // recursive, so not INL
+		if(dim == N - 1) {
+			const ptrdiff_t step = strides_[N - 1];
+			ElemT *end = p + shape_[N - 1] * step;
+			if(step == 1) {
+				for(; p < end; ++p) {
+					fn(*p);
+				}
+			} else {
+				for(int i = 0; i < shape_[N - 1]; ++i, p += step) {
+					fn(*p);
+				}
+			}
+			return;
+		}
+		for(int i = 0; i < shape_[dim]; ++i) {
+			forEachFrom(dim + 1, p + i * strides_[dim], fn);
+		}
+	}
+
+public:
+
+	INL RcNdView() {}
+
+	/** @brief dense row major view of an array, the shape must cover the array */
+	RcNdView(const RcArray<ElemT> &array, const int (&shape)[N])
+		: array_(array)
+		, base_(array ? const_cast<ElemT *>(array.elements()) : nullptr)
+	{
+		ptrdiff_t stride = 1;
+		for(int d = N - 1; d >= 0; --d) {
+			shape_[d] = shape[d];
+			strides_[d] = stride;
+			stride *= shape[d];
+		}
+		ARTD_ASSERT(stride <= (array ? array.length() : 0));
+	}
+
+	/**
+	 * @brief general view of an array, offset is the element at index 0 and
+	 * strides are in elements, every index must be within the array.
+	 */
+	RcNdView(const RcArray<ElemT> &array, int offset, const int (&shape)[N], const ptrdiff_t (&strides)[N])
+		: array_(array)
+		, base_(array ? const_cast<ElemT *>(array.elements()) + offset : nullptr)
+	{
+		ptrdiff_t last = offset;
+		for(int d = 0; d < N; ++d) {
+			shape_[d] = shape[d];
+			strides_[d] = strides[d];
+			ARTD_ASSERT(shape[d] >= 0 && strides[d] >= 0);
+			last += (shape[d] > 0 ? shape[d] - 1 : 0) * strides[d];
+		}
+		ARTD_ASSERT(offset >= 0 && (size() == 0 || last < (array ? array.length() : 0)));
+	}
+
+	INL const RcArray<ElemT> &array() const { return(array_); }
+	INL static int rank() { return(N); }
+	INL int shape(int dim) const { return(shape_[dim]); }
+	INL ptrdiff_t stride(int dim) const { return(strides_[dim]); }
+
+	/** @brief the number of elements in the view */
+	INL size_t size() const {
+		size_t n = 1;
+		for(int d = 0; d < N; ++d) {
+			n *= (size_t)shape_[d];
+		}
+		return(n);
+	}
+
+	/** @brief the element at index 0, for contiguous views the start of size() elements */
+	INL ElemT *data() { return(base_); }
+	INL const ElemT *data() const { return(base_); }
+
+	template<class... IndexT>
+	INL ElemT &operator()(IndexT... ix) {
+		return(*address(ix...));
+	}
+	template<class... IndexT>
+	INL const ElemT &operator()(IndexT... ix) const {
+		return(*address(ix...));
+	}
+	template<class... IndexT>
+	INL ElemT *address(IndexT... ix) const {
+		static_assert(sizeof...(IndexT) == N, "RcNdView needs an index for each dimension");
+		const int idx[N] = { (int)ix... };
+		ptrdiff_t ofs = 0;
+		for(int d = 0; d < N; ++d) {
+			ARTD_ASSERT((unsigned int)idx[d] < (unsigned int)shape_[d]);
+			ofs += idx[d] * strides_[d];
+		}
+		return(base_ + ofs);
+	}
+
+	/** @brief true if the elements are a dense row major block starting at data() */
+	bool isContiguous() const {
+		ptrdiff_t stride = 1;
+		for(int d = N - 1; d >= 0; --d) {
+			if(shape_[d] != 1 && strides_[d] != stride) {
+				return(false);
+			}
+			stride *= shape_[d];
+		}
+		return(true);
+	}
+
+	/** @brief calls fn(ElemT &) for each element in row major order */
+	template<class FuncT>
+	void forEach(FuncT fn) {
+		if(size() == 0) {
+			return;
+		}
+		if(isContiguous()) {
+			ElemT *p = base_;
+			ElemT *end = p + size();
+			for(; p < end; ++p) {
+				fn(*p);
+			}
+			return;
+		}
+		forEachFrom(0, base_, fn);
+	}
+
+	/** @brief view with the dimensions reordered, dimension d of the result is dimension axes[d] of this */
+	ThisT permute(const int (&axes)[N]) const {
+		ThisT v(*this);
+		for(int d = 0; d < N; ++d) {
+			ARTD_ASSERT((unsigned int)axes[d] < (unsigned int)N);
+			v.shape_[d] = shape_[axes[d]];
+			v.strides_[d] = strides_[axes[d]];
+		}
+		return(v);
+	}
+	/** @brief view with dimensions a and b swapped */
+	ThisT transpose(int a = N - 2, int b = N - 1) const {
+		static_assert(N > 1, "can't transpose a one dimensional view");
+		ARTD_ASSERT((unsigned int)a < (unsigned int)N && (unsigned int)b < (unsigned int)N);
+		ThisT v(*this);
+		v.shape_[a] = shape_[b];
+		v.strides_[a] = strides_[b];
+		v.shape_[b] = shape_[a];
+		v.strides_[b] = strides_[a];
+		return(v);
+	}
+
+	/** @brief view of count indices of dimension dim starting at start, every step'th one */
+	ThisT slice(int dim, int start, int count, int step = 1) const {
+		ARTD_ASSERT((unsigned int)dim < (unsigned int)N);
+		ARTD_ASSERT(start >= 0 && count >= 0 && step > 0);
+		ARTD_ASSERT(count == 0 || start + (count - 1) * step < shape_[dim]);
+		ThisT v(*this);
+		v.base_ = base_ + start * strides_[dim];
+		v.shape_[dim] = count;
+		v.strides_[dim] = strides_[dim] * step;
+		return(v);
+	}
+
+	/** @brief view of the N-1 dimensions at index ix of dimension dim, ie: a row or column */
+	RcNdView<ElemT, (N > 1 ? N - 1 : 1)> index(int dim, int ix) const {
+		static_assert(N > 1, "can't index a one dimensional view to a lower rank");
+		ARTD_ASSERT((unsigned int)dim < (unsigned int)N);
+		ARTD_ASSERT((unsigned int)ix < (unsigned int)shape_[dim]);
+		RcNdView<ElemT, (N > 1 ? N - 1 : 1)> v;
+		v.array_ = array_;
+		v.base_ = base_ + ix * strides_[dim];
+		for(int d = 0, o = 0; d < N; ++d) {
+			if(d != dim) {
+				v.shape_[o] = shape_[d];
+				v.strides_[o] = strides_[d];
+				++o;
+			}
+		}
+		return(v);
+	}
+
+	/** @brief repeats dimension dim, which must have a shape of 1, count times without copying */
+	ThisT broadcast(int dim, int count) const {
+		ARTD_ASSERT((unsigned int)dim < (unsigned int)N);
+		ARTD_ASSERT(shape_[dim] == 1 && count >= 0);
+		ThisT v(*this);
+		v.shape_[dim] = count;
+		v.strides_[dim] = 0;
+		return(v);
+	}
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_RcNdView_h
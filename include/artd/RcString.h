@@ -28,7 +28,9 @@
 #include "artd/ObjectBase.h"
 #include "artd/RcArray.h"
 #include "artd/FormatfArglist.h"
+#include "artd/StringAlgo.h"
 #include <string_view>
+#include <atomic>
 
 
 ARTD_BEGIN
@@ -46,10 +48,24 @@ protected:
 
     ARTD_API_JLIB_BASE string_object(int len);
 
+    // for static_string_object, chars must immediately follow this
+    constexpr string_object(int len, ChT* chars)
+        : ObjectBase(StaticObject())
+        , len_(len)
+        , hash_(0)
+#ifdef ENABLE_RCSTRING_VIEW
+        , chars_(chars)
+#endif
+    {
+        (void)chars;
+    }
+
 private:
 
     /** length of buffer in chars - not including any terminal "nul" */
     int        len_;
+    /** cached StringAlgo::hash() of the chars, 0 until first computed */
+    mutable std::atomic<uint32_t> hash_;
 
 #ifdef ENABLE_RCSTRING_VIEW
     ChT* chars_; // for debug build
@@ -88,6 +104,23 @@ public:
     /** @brief returns length of buffer in chars - not including terminal "nul" */
     INL int length() const { return(len_); }
 
+    /**
+     * @brief hash of the chars, computed on first call then cached.
+     * The chars of a string must not be modified once it has been hashed
+     * other than through RcStrBaseT::mutableChars() which resets it.
+     */
+    INL uint32_t hashCode() const {
+        uint32_t h = hash_.load(std::memory_order_relaxed);
+        if (h == 0) {
+            h = StringAlgo::hash(c_str(), len_);
+            hash_.store(h, std::memory_order_relaxed);
+        }
+        return(h);
+    }
+
+    /** @brief forget the cached hash, for when the chars are modified */
+    INL void resetHash() { hash_.store(0, std::memory_order_relaxed); }
+
     /** @brief returns size of string object in bytes for a specified charcount */
     INL static size_t sizeForChars(int numchars) { return((offsetOfChars() + sizeof(CharT)) + (numchars * sizeof(CharT))); }
 };
@@ -127,7 +160,8 @@ protected:
 public:
 
     static SubT createForSize(int charcount);
-//    static SubT createForSize(int charcount,const ChT *initialValue);
+    /** @brief new string of charcount chars copied from initialValue, which need not be null terminated */
+    static SubT createForSize(int charcount, const ChT *initialValue);
 
     static SubT vformat(const char* fmt, const FormatfArglist<>& args);
     static SubT vformat(const wchar_t* fmt, const FormatfArglist<>& args);
@@ -144,6 +178,11 @@ public:
         FormatfArglist<>::addArgs(arglist.args(), args...);
         return(vformat(fmt, arglist));
     }
+    /** @brief format with a format string parsed and checked at compile time, see ARTD_FMT() in FormatfCompiled.h */
+    template <typename FmtT, typename... Args, typename = typename FmtT::CompiledFormatTag>
+    static INL SubT format(const FmtT &, const Args &... args) {
+        return(FmtT::template format<SubT>(args...));
+    }
 
 protected:
     INL RcStrBaseT() {}
@@ -176,12 +215,41 @@ public:
     INL int length() const {
         return(super::get()->length());
     }
+    /** @brief cached hash of the chars, see string_object::hashCode() */
+    INL uint32_t hashCode() const {
+        return(super::get()->hashCode());
+    }
     INL const ChT* c_str() const {
         return(super::get()->c_str());
     }
+    /** writable chars of the string object, which may be shared, see mutableChars() */
     INL ChT* chars() {
         return(super::get()->chars());
     }
+
+    /**
+     * @brief true if this is the only handle to the string object.  Static
+     * literals and strings with no control block are never unique.
+     */
+    INL bool isUnique() const {
+        return(super::use_count() == 1);
+    }
+
+    /**
+     * @brief chars that may be modified in place, copy on write.
+     * If the string is shared it is first replaced by a copy that only this
+     * handle references.  The cached hash is reset.  Null if this is null.
+     */
+    ChT* mutableChars() {
+        if (!super::get()) {
+            return(nullptr);
+        }
+        if (!isUnique()) {
+            *this = SubT::createForSize(length(), c_str());
+        }
+        super::get()->resetHash();
+        return(super::get()->chars());
+    }
     INL ChT& operator[](int ix) {
         return(super::get()->chars()[ix]);
     }
@@ -194,6 +262,52 @@ public:
     INL operator const std::basic_string_view<ChT> () const {
         return(std::basic_string_view<CharT>(c_str(),length()));
     }
+
+    /** @brief true if equal to b ignoring ASCII case, false if either is null */
+    INL bool equalsIgnoreCase(const string_arg<ChT>& b) const {
+        if (!super::get() || !b) {
+            return(false);
+        }
+        const int len = length();
+        return(len == b.length() && StringAlgo::equalsIgnoreCase(c_str(), b.c_str(), len));
+    }
+    INL bool startsWith(const string_arg<ChT>& prefix) const {
+        if (!super::get() || !prefix) {
+            return(false);
+        }
+        return(StringAlgo::startsWith(c_str(), length(), prefix.c_str(), prefix.length()));
+    }
+    INL bool endsWith(const string_arg<ChT>& suffix) const {
+        if (!super::get() || !suffix) {
+            return(false);
+        }
+        return(StringAlgo::endsWith(c_str(), length(), suffix.c_str(), suffix.length()));
+    }
+    /** @brief index of first ch at or after fromIndex or -1 if none */
+    INL int indexOf(int ch, int fromIndex = 0) const {
+        if (!super::get()) {
+            return(-1);
+        }
+        return(StringAlgo::indexOf(c_str(), length(), ch, fromIndex));
+    }
+    INL int indexOf(const string_arg<ChT>& sub, int fromIndex = 0) const {
+        if (!super::get() || !sub) {
+            return(-1);
+        }
+        return(StringAlgo::indexOf(c_str(), length(), sub.c_str(), sub.length(), fromIndex));
+    }
+    INL int lastIndexOf(int ch) const {
+        if (!super::get()) {
+            return(-1);
+        }
+        return(StringAlgo::lastIndexOf(c_str(), length(), ch));
+    }
+    INL int lastIndexOf(const string_arg<ChT>& sub) const {
+        if (!super::get() || !sub) {
+            return(-1);
+        }
+        return(StringAlgo::lastIndexOf(c_str(), length(), sub.c_str(), sub.length()));
+    }
 };
 
 class RcWString;
@@ -334,6 +448,85 @@ INL RcStrBaseT<RcString, char> RcStrBaseT<RcString, char>::create(const RcString
     return(s);
 }
 
+/**
+ * A string_object image with its chars, constant initialized so it needs
+ * no allocation and no runtime construction. It is never freed.
+ */
+template<typename ChT, int N>
+class static_string_object
+    : public string_object<ChT>
+{
+    ChT chars_[N + 1];
+public:
+    constexpr static_string_object(const ChT (&lit)[N + 1])
+        : string_object<ChT>(N, chars_)
+        , chars_{}
+    {
+        for (int i = 0; i < N; ++i) {
+            chars_[i] = lit[i];
+        }
+    }
+};
+
+/**
+ * A constant RcString or RcWString literal.
+ *
+ *     static RcStringLiteral nullStr("[null]");
+ *     const RcString &s = nullStr;
+ *
+ * The handle it provides has no control block so it never allocates, and
+ * copying or releasing it does not touch any reference count. Declare it
+ * at namespace scope or as a static (it is constant initialized so can be
+ * used during static initialization) or use ARTD_RCSTR() in an expression.
+ */
+template<class SubT, int N>
+class RcStringLiteral
+{
+    typedef typename SubT::CharT ChT;
+    union {
+        static_string_object<ChT, N> obj_;  // never destroyed
+    };
+    const void* handle_[2];  // laid out as a std::shared_ptr with a null control block
+
+public:
+    constexpr RcStringLiteral(const ChT (&lit)[N + 1])
+        : obj_(lit)
+        , handle_{ static_cast<const string_object<ChT>*>(&obj_), nullptr }
+    {
+        static_assert(sizeof(SubT) == sizeof(handle_), "handle layout");
+    }
+    ~RcStringLiteral() {}
+
+    INL const SubT& str() const {
+        return(*reinterpret_cast<const SubT*>(&handle_[0]));
+    }
+    INL operator const SubT&() const {
+        return(str());
+    }
+};
+
+template<int N>
+RcStringLiteral(const char (&lit)[N]) -> RcStringLiteral<RcString, N - 1>;
+template<int N>
+RcStringLiteral(const wchar_t (&lit)[N]) -> RcStringLiteral<RcWString, N - 1>;
+
+template<class LitT>
+inline RcStringLiteral rcStringLiteral_ = RcStringLiteral(LitT::str());
+
+/**
+ * ARTD_RCSTR("text") or ARTD_RCSTR(L"text") is a const RcString& or
+ * const RcWString& to a constant initialized literal, see RcStringLiteral.
+ */
+#define ARTD_RCSTR(lit) ([]() -> decltype(auto) { \
+        struct _L_ { static constexpr decltype(auto) str() { return(lit); } }; \
+        return(::artd::rcStringLiteral_<_L_>.str()); }())
+
+// defined in RcString.cpp, declared here as they are used by inlines below
+template<>
+RcString RcStrBaseT<RcString, char>::createForSize(int charcount, const char *initialValue);
+template<>
+RcWString RcStrBaseT<RcWString, wchar_t>::createForSize(int charcount, const wchar_t *initialValue);
+
 #undef INL
 
 ARTD_END
@@ -347,32 +540,98 @@ ARTD_ALWAYS_INLINE std::ostream& operator<<(std::ostream& os, const artd::RcStri
     return(os);
 }
 
+ARTD_BEGIN
+
+/**
+ * Key views used by the transparent RcString comparators and hashers below so
+ * an RcString keyed container can be probed with a const char *, string_view
+ * or StringArg without creating a temporary RcString. A null key is empty.
+ */
+struct RcStringKey {
+    ARTD_ALWAYS_INLINE static std::string_view view(const RcString& s) {
+        return(s ? std::string_view(s.c_str(), s.length()) : std::string_view());
+    }
+    ARTD_ALWAYS_INLINE static std::string_view view(const StringArg& s) {
+        return(s.view());
+    }
+    ARTD_ALWAYS_INLINE static std::string_view view(const char* s) {
+        return(s ? std::string_view(s) : std::string_view());
+    }
+    ARTD_ALWAYS_INLINE static std::string_view view(std::string_view s) {
+        return(s);
+    }
+    ARTD_ALWAYS_INLINE static std::string_view view(const std::string& s) {
+        return(std::string_view(s));
+    }
+    ARTD_ALWAYS_INLINE static uint32_t hash(const RcString& s) {
+        return(s ? s.hashCode() : StringAlgo::hash("", 0));
+    }
+    template<class KeyT>
+    ARTD_ALWAYS_INLINE static uint32_t hash(const KeyT& s) {
+        const std::string_view v = view(s);
+        return(StringAlgo::hash(v.data(), (int)v.size()));
+    }
+};
+
+ARTD_END
+
 namespace std {
 
 template<>
 struct less<artd::RcString> {
-    
+
+    typedef void is_transparent;
+
     ARTD_ALWAYS_INLINE bool operator()(
                                        const artd::RcString& a,
                                        const artd::RcString& b) const
     {
-        if(a.c_str() == b.c_str()) {
+        if(a.get() == b.get()) {
             return(false);
         }
-        return(::strcmp(a.c_str(), b.c_str()) < 0);
+        return(artd::RcStringKey::view(a) < artd::RcStringKey::view(b));
+    }
+    template<class KeyA, class KeyB>
+    ARTD_ALWAYS_INLINE bool operator()(const KeyA& a, const KeyB& b) const
+    {
+        return(artd::RcStringKey::view(a) < artd::RcStringKey::view(b));
     }
 };
 
 template<>
-struct hash<artd::RcString> {
-    size_t operator()(const artd::RcString & keyVal) const
+struct equal_to<artd::RcString> {
+
+    typedef void is_transparent;
+
+    ARTD_ALWAYS_INLINE bool operator()(
+                                       const artd::RcString& a,
+                                       const artd::RcString& b) const
+    {
+        if(a.get() == b.get()) {
+            return(true);
+        }
+        return(artd::RcStringKey::view(a) == artd::RcStringKey::view(b));
+    }
+    template<class KeyA, class KeyB>
+    ARTD_ALWAYS_INLINE bool operator()(const KeyA& a, const KeyB& b) const
     {
-        const std::basic_string_view<char> sView(keyVal);
-        return(std::hash<std::string_view>{}(sView));
+        return(artd::RcStringKey::view(a) == artd::RcStringKey::view(b));
     }
 };
 
+// uses the hash cached in the string so rehashing and lookups by RcString
+// don't rescan the chars, other key types hash the chars the same way.
+template<>
+struct hash<artd::RcString> {
 
+    typedef void is_transparent;
+
+    template<class KeyT>
+    ARTD_ALWAYS_INLINE size_t operator()(const KeyT& keyVal) const
+    {
+        return(artd::RcStringKey::hash(keyVal));
+    }
+};
 
 } // end stc
 
@@ -386,17 +645,8 @@ class string_arg;
 typedef string_arg<char> StringArg;
 typedef string_arg<wchar_t> WStringArg;
 
-template<>
-INL int string_arg<char>::lengthFromRc() const {
-    return(((RcString*)obj_)->length());
-}
-template<>
-INL int string_arg<wchar_t>::lengthFromRc() const {
-    return(((RcWString*)obj_)->length());
-}
-
-INL FormatfArgBase::Arg::Arg(const string_arg<char>& arg) : type_(tCHARS) { value_.chars_ = arg.c_str(); }
-INL FormatfArgBase::Arg::Arg(const string_arg<wchar_t>& arg) : type_(tWCHARS) { value_.wchars_ = arg.c_str(); }
+INL FormatfArgBase::Arg::Arg(const string_arg<char>& arg) : type_(tCHARS), len_(arg.knownLength()) { value_.chars_ = arg.c_str(); }
+INL FormatfArgBase::Arg::Arg(const string_arg<wchar_t>& arg) : type_(tWCHARS), len_(arg.knownLength()) { value_.wchars_ = arg.c_str(); }
 
 
 INL void FormatfArgBase::Arg::initFromObject(ObjectBase *ob) {
@@ -407,31 +657,40 @@ INL void FormatfArgBase::Arg::initFromObject(ObjectBase *ob) {
 
 INL RcString::RcString(const string_arg<char>& sa) {
 
-    if (sa.type() == sa.RC_STRING) {
-        HackStdShared<ObjectBase> hsb((ObjectBase*)(sa.getObj()), ((ObjectBase*)(sa.getObj()))->cbPtr);
+    if (sa.type() == sa.RC_STRING && sa.getObj()) {
+        ObjectBase* obj = (ObjectBase*)(sa.getObj());
+        HackStdShared<ObjectBase> hsb(obj, obj->hasControlBlock() ? obj->cbPtr : nullptr);
         *this = *reinterpret_cast<RcString*>(&hsb);
     }
+    else if (sa.c_str()) {
+        ::new(this) super(createForSize(sa.length(), sa.c_str()));
+    }
     else {
-        ::new(this) super(sa.c_str());
+        ::new(this) super();
     }
 }
 
 INL bool RcString::equals(const string_arg<char> &b) const noexcept {
-    return(operator==(b.c_str()));
+    if (!get() || !b.c_str()) {
+        return(false);
+    }
+    const int len = length();
+    return(len == b.length() && ::memcmp(c_str(), b.c_str(), len) == 0);
 }
 
 INL bool RcString::operator()(const string_arg<char> &a, const string_arg<char> &b) const {
-    return(::strcmp(a.c_str(), b.c_str()) < 0);
+    return(a.view() < b.view());
 }
 
 INL RcWString::RcWString(const string_arg<wchar_t>& sa) {
 
-    if (sa.type() == sa.RC_STRING) {
-        HackStdShared<ObjectBase> hsb((ObjectBase*)(sa.getObj()), ((ObjectBase*)(sa.getObj()))->cbPtr);
+    if (sa.type() == sa.RC_STRING && sa.getObj()) {
+        ObjectBase* obj = (ObjectBase*)(sa.getObj());
+        HackStdShared<ObjectBase> hsb(obj, obj->hasControlBlock() ? obj->cbPtr : nullptr);
         *this = *reinterpret_cast<RcWString*>(&hsb);
     }
-    else {
-        ::new((void*)this) super(sa.c_str());
+    else if (sa.c_str()) {
+        ::new((void*)this) super(createForSize(sa.length(), sa.c_str()));
     }
 }
 
@@ -439,8 +698,15 @@ INL RcWString::RcWString(const string_arg<wchar_t>& sa) {
 
 template<>
 inline string_arg<char>::string_arg(const RcString& rc) : type_(RC_STRING) {
-    s_ = rc.c_str();
     obj_ = rc.get();
+    if (obj_) {
+        s_ = rc.c_str();
+        len_ = rc.length();
+    }
+    else {
+        s_ = nullptr;
+        len_ = 0;
+    }
 }
 
 ARTD_END
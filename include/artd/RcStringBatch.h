@@ -0,0 +1,104 @@
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+#ifndef __artd_RcStringBatch_h
+#define __artd_RcStringBatch_h
+
+#include "artd/RcString.h"
+#include "artd/StringArg.h"
+
+#define INL ARTD_ALWAYS_INLINE
+
+ARTD_BEGIN
+
+/**
+ * Conversions and hashing applied to whole arrays of strings.
+ *
+ * Each call takes count input strings and writes count results to out,
+ * which the caller sizes, ie: a std::vector.  The RcArray versions write
+ * into a pre-sized output array, copied first if it is shared, for the
+ * shorter of the two lengths.  Per string work uses the block kernels in
+ * StringAlgo and Utf8, and the batch call overhead is paid once rather
+ * than per string.
+ *
+ * threads splits the work over that many threads, 0 uses one per cpu
+ * core.  Small batches are not split.
+ *
+ * Null input strings give null output strings, and hash the same
+ * as empty strings.
+ */
+class ARTD_API_JLIB_BASE RcStringBatch
+{
+public:
+
+	/** @brief the StringAlgo::hash() of each string, for RcStrings this is their cached hashCode() */
+	static void hash(const RcString *in, int count, uint32_t *out, int threads = 1);
+	static void hash(const StringArg *in, int count, uint32_t *out, int threads = 1);
+
+	/** @brief ASCII case folded copies */
+	static void toLower(const RcString *in, int count, RcString *out, int threads = 1);
+	static void toLower(const StringArg *in, int count, RcString *out, int threads = 1);
+	static void toUpper(const RcString *in, int count, RcString *out, int threads = 1);
+	static void toUpper(const StringArg *in, int count, RcString *out, int threads = 1);
+
+	/** @brief wchar_t to utf8 */
+	static void toUtf8(const RcWString *in, int count, RcString *out, int threads = 1);
+	static void toUtf8(const WStringArg *in, int count, RcString *out, int threads = 1);
+	/** @brief utf8 to wchar_t */
+	static void toWide(const RcString *in, int count, RcWString *out, int threads = 1);
+	static void toWide(const StringArg *in, int count, RcWString *out, int threads = 1);
+
+	INL static void hash(const RcArray<RcString> &in, RcArray<uint32_t> &out, int threads = 1) {
+		forArrays(in, out, [threads](const RcString *i, int n, uint32_t *o) { hash(i, n, o, threads); });
+	}
+	INL static void toLower(const RcArray<RcString> &in, RcArray<RcString> &out, int threads = 1) {
+		forArrays(in, out, [threads](const RcString *i, int n, RcString *o) { toLower(i, n, o, threads); });
+	}
+	INL static void toUpper(const RcArray<RcString> &in, RcArray<RcString> &out, int threads = 1) {
+		forArrays(in, out, [threads](const RcString *i, int n, RcString *o) { toUpper(i, n, o, threads); });
+	}
+	INL static void toUtf8(const RcArray<RcWString> &in, RcArray<RcString> &out, int threads = 1) {
+		forArrays(in, out, [threads](const RcWString *i, int n, RcString *o) { toUtf8(i, n, o, threads); });
+	}
+	INL static void toWide(const RcArray<RcString> &in, RcArray<RcWString> &out, int threads = 1) {
+		forArrays(in, out, [threads](const RcString *i, int n, RcWString *o) { toWide(i, n, o, threads); });
+	}
+
+private:
+	template<class InT, class OutT, class FuncT>
+	INL static void forArrays(const RcArray<InT> &in, RcArray<OutT> &out, FuncT fn) {
+		if(in && out) {
+			const int count = (in.length() < out.length()) ? in.length() : out.length();
+			if(count > 0) {
+				OutT *pout = out.mutableElements();
+				fn(in.elements(), count, pout);
+			}
+		}
+	}
+};
+
+ARTD_END
+
+#undef INL
+
+#endif // __artd_RcStringBatch_h
@@ -0,0 +1,445 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#ifndef __artd_RcStringMap_h
+#define __artd_RcStringMap_h
+
+#include "artd/RcString.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ARTD_RCSTRINGMAP_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * A read mostly map of RcString keys to values for tables shared between threads.
+ *
+ * Readers never lock. The map publishes an immutable table which readers
+ * look up in directly, a writer builds a new table with a batch of changes,
+ * publishes it, waits for any readers still in the old table to leave, then
+ * frees the old one (RCU style). Writers are serialized with a mutex and each
+ * commit copies the table so batch changes together with Batch and commit().
+ *
+ * The tables are open addressed in groups of 16 slots each with a byte of
+ * control tag (7 bits of the hash), a group is probed with one SIMD compare.
+ * Keys are hashed with RcString::hashCode() which is cached in the string,
+ * lookups by std::string_view, string_arg or const char * hash the chars with
+ * the same function and never create a temporary RcString.
+ *
+ * Values are returned by copy (or visited) while the reader is in the table
+ * so ObjectPtr values are safely referenced before the table can be freed.
+ */
+template<class ValT>
+class RcStringMap
+{
+public:
+	typedef ValT ValueT;
+
+	/** a set of changes to apply in one commit() */
+	class Batch
+	{
+		friend class RcStringMap<ValT>;
+		struct Change {
+			RcString key;
+			ValT value;
+			bool remove;
+		};
+		std::vector<Change> changes_;
+	public:
+		INL void put(const RcString& key, const ValT& value) {
+			changes_.push_back(Change{ key, value, false });
+		}
+		INL void remove(const RcString& key) {
+			changes_.push_back(Change{ key, ValT(), true });
+		}
+		INL size_t size() const { return(changes_.size()); }
+		INL void clear() { changes_.clear(); }
+	};
+
+private:
+
+	static const int GroupSize = 16;
+	static const uint8_t EmptyTag = 0x80;
+
+	struct Slot {
+		RcString key;
+		ValT value;
+	};
+
+	struct Group {
+		uint8_t tags[GroupSize];
+		Slot slots[GroupSize];
+	};
+
+	struct Table {
+		size_t groupMask;
+		size_t count;
+		Group *groups;
+
+		Table(size_t numGroups) : groupMask(numGroups - 1), count(0) {
+			groups = new Group[numGroups];
+			for (size_t i = 0; i < numGroups; ++i) {
+				::memset(groups[i].tags, EmptyTag, GroupSize);
+			}
+		}
+		~Table() {
+			delete[] groups;
+		}
+	};
+
+	// bit mask of the slots in a group whose tag equals tag
+	INL static unsigned int matchTag(const uint8_t* tags, uint8_t tag) {
+#ifdef ARTD_RCSTRINGMAP_SSE2
+		const __m128i g = _mm_loadu_si128((const __m128i*)tags);
+		return((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag))));
+#else
+		unsigned int mask = 0;
+		for (int i = 0; i < GroupSize; ++i) {
+			mask |= (unsigned int)(tags[i] == tag) << i;
+		}
+		return(mask);
+#endif
+	}
+
+	INL static int lowestBit(unsigned int mask) {
+#if defined(__GNUC__)
+		return(__builtin_ctz(mask));
+#else
+		int ix = 0;
+		while (!(mask & 1)) {
+			mask >>= 1;
+			++ix;
+		}
+		return(ix);
+#endif
+	}
+
+	// removed slots have a null key while a commit builds, those never match
+	INL static bool keyEquals(const RcString& k, const char* key, int keyLen) {
+		const RcString::ObjT* obj = k.get();
+		return(obj && obj->length() == keyLen && ::memcmp(obj->c_str(), key, keyLen) == 0);
+	}
+
+	INL static uint8_t tagOf(uint32_t hash) { return((uint8_t)(hash & 0x7F)); }
+	INL static size_t groupOf(uint32_t hash) { return(hash >> 7); }
+
+	static const Slot* findIn(const Table* t, uint32_t hash, const char* key, int keyLen) {
+		const uint8_t tag = tagOf(hash);
+		size_t g = groupOf(hash) & t->groupMask;
+		for (size_t probe = 1;; ++probe) {
+			const Group& grp = t->groups[g];
+			unsigned int mask = matchTag(grp.tags, tag);
+			while (mask) {
+				const Slot& slot = grp.slots[lowestBit(mask)];
+				if (keyEquals(slot.key, key, keyLen)) {
+					return(&slot);
+				}
+				mask &= mask - 1;
+			}
+			if (matchTag(grp.tags, EmptyTag)) {
+				return(nullptr);
+			}
+			g = (g + probe) & t->groupMask; // triangular probing visits every group
+		}
+	}
+
+	// only used while building a new unpublished table
+	static void insertInto(Table* t, const RcString& key, const ValT& value) {
+		const uint32_t hash = key.hashCode();
+		const uint8_t tag = tagOf(hash);
+		size_t g = groupOf(hash) & t->groupMask;
+		for (size_t probe = 1;; ++probe) {
+			Group& grp = t->groups[g];
+			unsigned int mask = matchTag(grp.tags, tag);
+			while (mask) {
+				Slot& slot = grp.slots[lowestBit(mask)];
+				if (keyEquals(slot.key, key.c_str(), key.length())) {
+					slot.value = value;
+					return;
+				}
+				mask &= mask - 1;
+			}
+			mask = matchTag(grp.tags, EmptyTag);
+			if (mask) {
+				const int ix = lowestBit(mask);
+				grp.tags[ix] = tag;
+				grp.slots[ix].key = key;
+				grp.slots[ix].value = value;
+				++t->count;
+				return;
+			}
+			g = (g + probe) & t->groupMask;
+		}
+	}
+
+	// groups needed to keep the load under 7/8
+	static size_t groupsFor(size_t count) {
+		size_t groups = 1;
+		while (groups * GroupSize * 7 < count * 8) {
+			groups <<= 1;
+		}
+		return(groups);
+	}
+
+	// ******** reader tracking
+	//
+	// A reader counts itself in the slot for the current epoch, then checks
+	// the epoch didn't change before it reads the table pointer. A writer
+	// swaps the table, flips the epoch and waits for the prior epoch's
+	// count to reach zero, after which nobody can be looking at the old table.
+
+	struct alignas(64) ReaderCount {
+		std::atomic<int> n{ 0 };
+	};
+
+	std::atomic<Table*>     table_;
+	std::atomic<unsigned>   epoch_{ 0 };
+	mutable ReaderCount     readers_[2];
+	std::mutex              writeLock_;
+
+	INL unsigned enterRead() const {
+		for (;;) {
+			const unsigned e = epoch_.load(std::memory_order_seq_cst);
+			readers_[e & 1].n.fetch_add(1, std::memory_order_seq_cst);
+			if (epoch_.load(std::memory_order_seq_cst) == e) {
+				return(e);
+			}
+			readers_[e & 1].n.fetch_sub(1, std::memory_order_release);
+		}
+	}
+	INL void leaveRead(unsigned e) const {
+		readers_[e & 1].n.fetch_sub(1, std::memory_order_release);
+	}
+
+	void publish(Table* t) {
+		Table* old = table_.exchange(t, std::memory_order_seq_cst);
+		const unsigned e = epoch_.load(std::memory_order_relaxed);
+		epoch_.store(e + 1, std::memory_order_seq_cst);
+		while (readers_[e & 1].n.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+		delete old;
+	}
+
+	template<class FuncT>
+	INL bool visitHashed(uint32_t hash, const char* key, int keyLen, FuncT&& fn) const {
+		const unsigned e = enterRead();
+		const Slot* slot = findIn(table_.load(std::memory_order_seq_cst), hash, key, keyLen);
+		if (slot) {
+			fn(slot->value);
+		}
+		leaveRead(e);
+		return(slot != nullptr);
+	}
+
+	RcStringMap(const RcStringMap&) = delete;
+	RcStringMap& operator=(const RcStringMap&) = delete;
+
+public:
+
+	RcStringMap() : table_(new Table(1)) {}
+
+	~RcStringMap() {
+		delete table_.load();
+	}
+
+	/**
+	 * Calls fn(const ValT &) for the value at key if present while the table is held.
+	 * fn should be short as it holds up writers freeing old tables.
+	 * @return true if found
+	 */
+	template<class FuncT>
+	INL bool visit(const RcString& key, FuncT&& fn) const {
+		if (!key) {
+			return(false);
+		}
+		return(visitHashed(key.hashCode(), key.c_str(), key.length(), std::forward<FuncT>(fn)));
+	}
+	template<class FuncT>
+	INL bool visit(std::string_view key, FuncT&& fn) const {
+		return(visitHashed(StringAlgo::hash(key.data(), (int)key.size()), key.data(), (int)key.size(), std::forward<FuncT>(fn)));
+	}
+	template<class FuncT>
+	INL bool visit(const string_arg<char>& key, FuncT&& fn) const {
+		if (!key.c_str()) {
+			return(false);
+		}
+		if (key.type() == key.RC_STRING && key.getObj()) {
+			const RcString::ObjT* obj = static_cast<const RcString::ObjT*>(key.getObj());
+			return(visitHashed(obj->hashCode(), obj->c_str(), obj->length(), std::forward<FuncT>(fn)));
+		}
+		const int len = key.length();
+		return(visitHashed(StringAlgo::hash(key.c_str(), len), key.c_str(), len, std::forward<FuncT>(fn)));
+	}
+	template<class FuncT>
+	INL bool visit(const char* key, FuncT&& fn) const {
+		if (!key) {
+			return(false);
+		}
+		return(visit(std::string_view(key), std::forward<FuncT>(fn)));
+	}
+
+	/** @brief copies the value at key into out, returns false and leaves out unchanged if not present */
+	template<class KeyT>
+	INL bool get(const KeyT& key, ValT& out) const {
+		return(visit(key, [&out](const ValT& v) { out = v; }));
+	}
+	/** @brief returns the value at key or notFound */
+	template<class KeyT>
+	INL ValT get(const KeyT& key, const ValT& notFound = ValT()) const {
+		ValT ret(notFound);
+		visit(key, [&ret](const ValT& v) { ret = v; });
+		return(ret);
+	}
+	template<class KeyT>
+	INL bool containsKey(const KeyT& key) const {
+		return(visit(key, [](const ValT&) {}));
+	}
+
+	/** @brief number of entries in the currently published table */
+	size_t size() const {
+		const unsigned e = enterRead();
+		const size_t ret = table_.load(std::memory_order_seq_cst)->count;
+		leaveRead(e);
+		return(ret);
+	}
+
+	/**
+	 * Calls fn(const RcString &key, const ValT &value) for every entry of
+	 * the currently published table, the table is held for the duration.
+	 */
+	template<class FuncT>
+	void forEach(FuncT&& fn) const {
+		const unsigned e = enterRead();
+		const Table* t = table_.load(std::memory_order_seq_cst);
+		for (size_t g = 0; g <= t->groupMask; ++g) {
+			const Group& grp = t->groups[g];
+			for (int i = 0; i < GroupSize; ++i) {
+				if (grp.tags[i] != EmptyTag) {
+					fn(grp.slots[i].key, grp.slots[i].value);
+				}
+			}
+		}
+		leaveRead(e);
+	}
+
+	/**
+	 * Applies all the changes in batch in order as one new table and publishes it.
+	 * Returns after readers of the prior table have left it and it is freed.
+	 */
+	void commit(const Batch& batch) {
+		if (batch.changes_.empty()) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(writeLock_);
+		const Table* cur = table_.load(std::memory_order_relaxed);
+
+		// apply the changes in order to a table sized for the worst case,
+		// if anything was removed rebuild it without the removed slots
+		Table* t = new Table(groupsFor(cur->count + batch.changes_.size()));
+		for (size_t g = 0; g <= cur->groupMask; ++g) {
+			const Group& grp = cur->groups[g];
+			for (int i = 0; i < GroupSize; ++i) {
+				if (grp.tags[i] != EmptyTag) {
+					insertInto(t, grp.slots[i].key, grp.slots[i].value);
+				}
+			}
+		}
+		bool removed = false;
+		for (const typename Batch::Change& c : batch.changes_) {
+			if (!c.key) {
+				continue;
+			}
+			if (c.remove) {
+				removed |= markRemoved(t, c.key);
+			} else {
+				insertInto(t, c.key, c.value);
+			}
+		}
+		if (removed) {
+			t = compact(t);
+		}
+		publish(t);
+	}
+
+	INL void put(const RcString& key, const ValT& value) {
+		Batch b;
+		b.put(key, value);
+		commit(b);
+	}
+	INL void remove(const RcString& key) {
+		Batch b;
+		b.remove(key);
+		commit(b);
+	}
+	void clear() {
+		std::lock_guard<std::mutex> lock(writeLock_);
+		publish(new Table(1));
+	}
+
+private:
+
+	// Removed slots keep their tag so probe chains stay intact while building,
+	// compact() then rebuilds without them.
+	static bool markRemoved(Table* t, const RcString& key) {
+		const uint32_t hash = key.hashCode();
+		Slot* slot = const_cast<Slot*>(findIn(t, hash, key.c_str(), key.length()));
+		if (!slot) {
+			return(false);
+		}
+		slot->key = nullptr;
+		slot->value = ValT();
+		--t->count;
+		return(true);
+	}
+
+	static Table* compact(Table* t) {
+		Table* nt = new Table(groupsFor(t->count));
+		for (size_t g = 0; g <= t->groupMask; ++g) {
+			Group& grp = t->groups[g];
+			for (int i = 0; i < GroupSize; ++i) {
+				if (grp.tags[i] != EmptyTag && grp.slots[i].key) {
+					insertInto(nt, grp.slots[i].key, grp.slots[i].value);
+				}
+			}
+		}
+		delete t;
+		return(nt);
+	}
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_RcStringMap_h
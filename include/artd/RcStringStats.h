@@ -0,0 +1,87 @@
+/*-
+ * Copyright (c) 1998-2011 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+#ifndef __artd_RcStringStats_h
+#define __artd_RcStringStats_h
+
+#include "artd/jlib_base.h"
+#include "artd/int_types.h"
+#include <atomic>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+class RcString;
+
+/**
+ * Opt in memory accounting for RcString and RcWString allocations.
+ *
+ * When enabled one in every sampleEvery string allocations is recorded,
+ * accumulating a histogram of string lengths, the number that would fit
+ * in a small string buffer, and for strings created from existing chars
+ * a fingerprint of the contents so the most duplicated values and the
+ * bytes they hold can be reported.  Strings that are sized first and
+ * filled in afterwards, ie: formatted or converted strings, are counted
+ * by length only.
+ *
+ * When disabled the cost to string creation is one relaxed atomic load.
+ */
+class ARTD_API_JLIB_BASE RcStringStats
+{
+public:
+
+	/** strings whose chars and null fit in this many bytes are counted as "small" */
+	static const int SmallStringBytes = 16;
+
+	/** @brief starts sampling every sampleEvery'th string allocation */
+	static void enable(int sampleEvery = 1);
+	/** @brief stops sampling, the accumulated data is kept until reset() */
+	static void disable();
+	/** @brief discards all the accumulated data */
+	static void reset();
+
+	INL static bool isEnabled() {
+		return(sampleEvery_.load(std::memory_order_relaxed) != 0);
+	}
+
+	/** @brief formatted report of the accumulated data with the topN most duplicated values */
+	static RcString report(int topN = 20);
+
+	/** called on string allocation, chars is null if the contents are not yet known */
+	INL static void onAllocate(int charCount, int charSize, const void *chars) {
+		if(isEnabled()) {
+			sample(charCount, charSize, chars);
+		}
+	}
+
+private:
+	static std::atomic<int> sampleEvery_;
+	static void sample(int charCount, int charSize, const void *chars);
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_RcStringStats_h
@@ -0,0 +1,263 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+
+#ifndef __artd_RcVector_h
+#define __artd_RcVector_h
+
+#include "artd/RcArray.h"
+#include "artd/artd_assert.h"
+#include <utility>
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * Growable reference counted sequence built on the RcArray allocation.
+ *
+ * The elements live in the same kind of object an RcArray<ElemT> uses, with
+ * room for capacity() elements of which the first size() are constructed.
+ * Copies of an RcVector share the buffer and the first one modified makes
+ * its own copy.  Appending grows the capacity geometrically.
+ *
+ * freeze() hands the buffer to an RcArray<ElemT> without copying, so
+ * arrays can be built in place by appending.  Call shrink_to_fit() first
+ * if the spare capacity is not wanted in the array.
+ */
+template<class ElemT>
+class RcVector
+{
+	typedef RcArrayObj<ElemT> ObjT;
+	typedef RcVector<ElemT> ThisT;
+
+	ObjectPtr<ObjT> buf_;
+	int cap_ = 0;
+
+	static const int MinCapacity = 4;
+
+	INL ElemT *elems() const {
+		return(const_cast<ElemT *>(buf_->elements()));
+	}
+
+	// new buffer of capacity elements holding the current ones, moved if this
+	// is the only reference to them otherwise copied.
+	void reallocate(int capacity) {
+		ObjectPtr<ObjT> nbuf = ObjT::allocateEmpty(capacity);
+		const int count = size();
+		if(count > 0) {
+			ElemT *dst = nbuf->elements();
+			ElemT *src = elems();
+			const bool shared = buf_.use_count() > 1;
+			if constexpr (std::is_trivially_copyable<ElemT>::value) {
+				::memcpy((void *)dst, src, count * sizeof(ElemT));
+			} else {
+				bool copy = false;
+				if constexpr (std::is_copy_constructible<ElemT>::value) {
+					copy = shared;
+				} else {
+					// vectors of move only types can't be modified while shared
+					ARTD_ASSERT(!shared);
+				}
+				for(int i = 0; i < count; ++i) {
+					if constexpr (std::is_copy_constructible<ElemT>::value) {
+						if(copy) {
+							::new(dst + i) ElemT(src[i]);
+							continue;
+						}
+					}
+					::new(dst + i) ElemT(std::move(src[i]));
+				}
+			}
+			nbuf->len_ = count;
+		}
+		buf_ = std::move(nbuf);
+		cap_ = capacity;
+	}
+	INL void makeUnique() {
+		if(buf_ && buf_.use_count() > 1) {
+			reallocate(cap_);
+		}
+	}
+	// unique buffer with room for count more elements
+	INL void prepareToAdd(int count) {
+		const int needed = size() + count;
+		if(needed > cap_) {
+			int grown = cap_ + (cap_ >> 1);
+			reallocate(needed > grown ? (needed > MinCapacity ? needed : MinCapacity) : grown);
+		} else {
+			makeUnique();
+		}
+	}
+
+public:
+
+	INL RcVector() {}
+	INL RcVector(std::nullptr_t) {}
+	explicit RcVector(int capacity) {
+		reserve(capacity);
+	}
+
+	INL RcVector(const ThisT &r) : buf_(r.buf_), cap_(r.cap_) {}
+	INL RcVector(ThisT &&r) : buf_(std::move(r.buf_)), cap_(r.cap_) { r.cap_ = 0; }
+
+	INL ThisT &operator=(const ThisT &r) {
+		buf_ = r.buf_;
+		cap_ = r.cap_;
+		return(*this);
+	}
+	INL ThisT &operator=(ThisT &&r) {
+		buf_ = std::move(r.buf_);
+		cap_ = r.cap_;
+		r.cap_ = 0;
+		return(*this);
+	}
+
+	INL int size() const { return(buf_ ? buf_->len_ : 0); }
+	INL int length() const { return(size()); }
+	INL int capacity() const { return(cap_); }
+	INL bool empty() const { return(size() == 0); }
+
+	INL const ElemT *data() const { return(buf_ ? buf_->elements() : nullptr); }
+	/** makes the elements unique to this vector before returning them */
+	INL ElemT *mutableData() {
+		makeUnique();
+		return(buf_ ? elems() : nullptr);
+	}
+
+	INL const ElemT &operator[](int ix) const { return(data()[ix]); }
+	INL const ElemT *begin() const { return(data()); }
+	INL const ElemT *end() const { return(data() + size()); }
+	INL const ElemT &back() const { return(data()[size() - 1]); }
+
+	/** @brief replaces the element at ix, copying the buffer first if it is shared */
+	INL void set(int ix, const ElemT &v) { mutableData()[ix] = v; }
+	INL void set(int ix, ElemT &&v) { mutableData()[ix] = std::move(v); }
+
+	void reserve(int capacity) {
+		if(capacity > cap_) {
+			reallocate(capacity);
+		}
+	}
+	/** @brief reduces the capacity to the size, this copies or moves the elements */
+	void shrink_to_fit() {
+		if(cap_ > size()) {
+			if(size() == 0) {
+				buf_ = nullptr;
+				cap_ = 0;
+			} else {
+				reallocate(size());
+			}
+		}
+	}
+
+	template<class... ArgsT>
+	ElemT &emplace_back(ArgsT&&... args) {
+		prepareToAdd(1);
+		ElemT *pelem = ::new(elems() + buf_->len_) ElemT(std::forward<ArgsT>(args)...);
+		++buf_->len_;
+		return(*pelem);
+	}
+	INL void push_back(const ElemT &v) {
+		if(size() < cap_ && buf_.use_count() == 1) {
+			::new(elems() + buf_->len_) ElemT(v);
+			++buf_->len_;
+			return;
+		}
+		ElemT copy(v); // v may be an element of this vector
+		emplace_back(std::move(copy));
+	}
+	INL void push_back(ElemT &&v) {
+		emplace_back(std::move(v));
+	}
+
+	/** @brief appends copies of count elements from src */
+	void append(const ElemT *src, int count) {
+		if(count <= 0) {
+			return;
+		}
+		prepareToAdd(count);
+		ElemT *dst = elems() + buf_->len_;
+		if constexpr (std::is_trivially_copyable<ElemT>::value) {
+			::memcpy((void *)dst, src, count * sizeof(ElemT));
+		} else {
+			for(int i = 0; i < count; ++i) {
+				::new(dst + i) ElemT(src[i]);
+			}
+		}
+		buf_->len_ += count;
+	}
+
+	void pop_back() {
+		makeUnique();
+		int last = --buf_->len_;
+		elems()[last].~ElemT();
+	}
+
+	/** @brief sets the size, new elements are value initialized */
+	void resize(int count) {
+		if(count > size()) {
+			prepareToAdd(count - size());
+			ElemT *pelem = elems();
+			for(int i = buf_->len_; i < count; ++i) {
+				::new(pelem + i) ElemT();
+			}
+			buf_->len_ = count;
+		} else {
+			while(size() > count) {
+				pop_back();
+			}
+		}
+	}
+
+	/** @brief empties the vector, the capacity is kept if the buffer is not shared */
+	void clear() {
+		if(buf_ && buf_.use_count() > 1) {
+			buf_ = nullptr;
+			cap_ = 0;
+			return;
+		}
+		while(size() > 0) {
+			pop_back();
+		}
+	}
+
+	/**
+	 * @brief returns the elements as an RcArray without copying them, this vector
+	 * is left empty.  If the buffer is shared with other vectors they keep it
+	 * and will copy it before modifying it.
+	 */
+	RcArray<ElemT> freeze() {
+		if(!buf_) {
+			return(RcArray<ElemT>(0));
+		}
+		cap_ = 0;
+		return(RcArray<ElemT>(std::move(buf_)));
+	}
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_RcVector_h
@@ -0,0 +1,119 @@
+/*-
+ * Copyright (c) 1998-2022 Peter Kennard and aRt&D Lab
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of the source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Any redistribution solely in binary form must conspicuously
+ *    reproduce the following disclaimer in documentation provided with the
+ *    binary redistribution.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'', WITHOUT ANY WARRANTIES, EXPRESS
+ * OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  LICENSOR SHALL
+ * NOT BE LIABLE FOR ANY LOSS OR DAMAGES RESULTING FROM THE USE OF THIS
+ * SOFTWARE, EITHER ALONE OR IN COMBINATION WITH ANY OTHER SOFTWARE.
+ *
+ * 	$Id$
+ */
+#ifndef __artd_StringAlgo_h
+#define __artd_StringAlgo_h
+
+#include "artd/jlib_base.h"
+#include "artd/int_types.h"
+#include "artd/os_string.h"
+
+ARTD_BEGIN
+
+#define INL ARTD_ALWAYS_INLINE
+
+/**
+ * Searching and ASCII case folding primitives for counted strings.
+ *
+ * These work on explicit lengths and never read past the end of the
+ * input so they may be used on strings that are not null terminated.
+ * On x86 the char versions use SSE2 or AVX2 kernels selected at
+ * runtime from the cpu features, other targets use scalar code.
+ * The wchar_t versions are scalar.
+ *
+ * Index results follow the java conventions, -1 if not found,
+ * and an empty substring is found at fromIndex.
+ */
+class ARTD_API_JLIB_BASE StringAlgo
+{
+public:
+
+	INL static int toLowerAscii(int c) {
+		return(((unsigned int)(c - 'A') < 26u) ? (c | 0x20) : c);
+	}
+	INL static int toUpperAscii(int c) {
+		return(((unsigned int)(c - 'a') < 26u) ? (c & ~0x20) : c);
+	}
+
+	static int indexOf(const char *s, int len, int ch, int fromIndex = 0);
+	static int indexOf(const char *s, int len, const char *sub, int subLen, int fromIndex = 0);
+	static int lastIndexOf(const char *s, int len, int ch);
+	static int lastIndexOf(const char *s, int len, const char *sub, int subLen);
+
+	/** @brief true if the first len chars of a and b match ignoring ASCII case */
+	static bool equalsIgnoreCase(const char *a, const char *b, int len);
+	/** @brief compares ignoring ASCII case, returns < 0, 0, > 0 like strcmp() */
+	static int compareIgnoreCase(const char *a, int aLen, const char *b, int bLen);
+
+	/** @brief ASCII case fold len chars from in to out, in and out may be the same buffer */
+	static void toLower(char *out, const char *in, int len);
+	static void toUpper(char *out, const char *in, int len);
+
+	INL static bool startsWith(const char *s, int len, const char *prefix, int prefixLen) {
+		return(prefixLen <= len && ::memcmp(s, prefix, prefixLen) == 0);
+	}
+	INL static bool endsWith(const char *s, int len, const char *suffix, int suffixLen) {
+		return(suffixLen <= len && ::memcmp(s + (len - suffixLen), suffix, suffixLen) == 0);
+	}
+	INL static bool startsWithIgnoreCase(const char *s, int len, const char *prefix, int prefixLen) {
+		return(prefixLen <= len && equalsIgnoreCase(s, prefix, prefixLen));
+	}
+
+	static int indexOf(const wchar_t *s, int len, int ch, int fromIndex = 0);
+	static int indexOf(const wchar_t *s, int len, const wchar_t *sub, int subLen, int fromIndex = 0);
+	static int lastIndexOf(const wchar_t *s, int len, int ch);
+	static int lastIndexOf(const wchar_t *s, int len, const wchar_t *sub, int subLen);
+	static bool equalsIgnoreCase(const wchar_t *a, const wchar_t *b, int len);
+	static int compareIgnoreCase(const wchar_t *a, int aLen, const wchar_t *b, int bLen);
+	static void toLower(wchar_t *out, const wchar_t *in, int len);
+	static void toUpper(wchar_t *out, const wchar_t *in, int len);
+
+	INL static bool startsWith(const wchar_t *s, int len, const wchar_t *prefix, int prefixLen) {
+		return(prefixLen <= len && ::wmemcmp(s, prefix, prefixLen) == 0);
+	}
+	INL static bool endsWith(const wchar_t *s, int len, const wchar_t *suffix, int suffixLen) {
+		return(suffixLen <= len && ::wmemcmp(s + (len - suffixLen), suffix, suffixLen) == 0);
+	}
+	INL static bool startsWithIgnoreCase(const wchar_t *s, int len, const wchar_t *prefix, int prefixLen) {
+		return(prefixLen <= len && equalsIgnoreCase(s, prefix, prefixLen));
+	}
+
+	/**
+	 * @brief hash of len chars, this is the hash RcString caches and the RcString
+	 * hashers and maps use so lookups by other string types agree with it.
+	 * Never returns 0 which is used to mark "not yet computed".
+	 */
+	static uint32_t hash(const char *s, int len);
+	INL static uint32_t hash(const wchar_t *s, int len) {
+		return(hash((const char *)s, len * (int)sizeof(wchar_t)));
+	}
+
+	/** @brief name of the kernel set selected for this cpu "avx2", "sse2" or "scalar" */
+	static const char *kernelName();
+};
+
+#undef INL
+
+ARTD_END
+
+#endif // __artd_StringAlgo_h
@@ -4,8 +4,10 @@
 
 #include "artd/jlib_base.h"
 #include "artd/os_string.h"
+#include "artd/StringAlgo.h"
 
 #include <ostream>
+#include <string_view>
 
 // forward declaration of std::string types (messy)
 
@@ -68,37 +70,50 @@ public:
 	enum SType {
 		C_STRING = 0,
 		STD_STRING,
-		RC_STRING
+		RC_STRING,
+		STRING_VIEW  // c_str() may not be null terminated, use length()
 	};
 	
 protected:
 	const CharT *	s_;
 	const void  *	obj_;
 	SType			type_;
+	// length in chars when known, -1 until measured for a bare pointer,
+	// so a string_arg passed down through layers is measured at most once.
+	mutable int		len_;
 	
 	typedef string_arg<CharT> MyType;
 	
 public:
 	
 	INL string_arg()
-		: s_(0), obj_(0), type_(C_STRING)
+		: s_(0), obj_(0), type_(C_STRING), len_(0)
 	{}
 	
 	INL string_arg(const int &)
-		: s_(0), obj_(0), type_(C_STRING)
+		: s_(0), obj_(0), type_(C_STRING), len_(0)
 	{}
 	
 	INL string_arg(CharT *v)
-		: s_(v), obj_(0), type_(C_STRING)
+		: s_(v), obj_(0), type_(C_STRING), len_(v ? -1 : 0)
 	{}
 	
 	INL string_arg(const CharT *v)
-		: s_(v), obj_(0), type_(C_STRING)
+		: s_(v), obj_(0), type_(C_STRING), len_(v ? -1 : 0)
+	{}
+
+	/** @brief chars with a known length, v[len] need not be a null */
+	INL string_arg(const CharT *v, int len)
+		: s_(v), obj_(0), type_(STRING_VIEW), len_(v ? len : 0)
+	{}
+
+	INL string_arg(std::basic_string_view<CharT> v)
+		: s_(v.data()), obj_(0), type_(STRING_VIEW), len_((int)v.size())
 	{}
 
 #ifdef ARTD_SUPPORT_STD_STRING
 	INL string_arg(const std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > &s)
-		: s_(s.c_str()), obj_(0), type_(STD_STRING)
+		: s_(s.c_str()), obj_(0), type_(STD_STRING), len_((int)s.size())
 	{}
 #endif	
 
@@ -112,30 +127,52 @@ public:
 	}
 #endif
     
-	int lengthFromRc() const;
-
 public:
 	
 	INL SType type() const { return(type_); }
 	INL const void *getObj() const { return(obj_); }
+	/** @brief the chars, null terminated unless type() is STRING_VIEW */
 	INL const CharT *c_str() const { return(s_); }
+	INL bool isNullTerminated() const { return(type_ != STRING_VIEW); }
 
-	int length() const {
-		if (type_ == RC_STRING) {
-			if (obj_ != nullptr) {
-				lengthFromRc();
-			}
+	/** @brief length in chars, only measures a bare pointer and only the first time */
+	INL int length() const {
+		if (len_ < 0) {
+			len_ = (int)std::char_traits<CharT>::length(s_);
 		}
-		if (s_ == NULL) {
-			return(0);
-		}
-        // TODO: use size_t ? 
-		if (sizeof(CharT) == sizeof(char)) {
-			return((int)::strlen((const char *)s_));
-		}
-		else {
-			return((int)::wcslen((const wchar_t *)s_));
+		return(len_);
+	}
+	/** @brief length if already known without measuring, else -1 */
+	INL int knownLength() const { return(len_); }
+
+	INL std::basic_string_view<CharT> view() const {
+		return(s_ ? std::basic_string_view<CharT>(s_, length()) : std::basic_string_view<CharT>());
+	}
+
+	INL bool equalsIgnoreCase(const MyType &b) const {
+		if (!s_ || !b.s_) {
+			return(false);
 		}
+		const int len = length();
+		return(len == b.length() && StringAlgo::equalsIgnoreCase(s_, b.s_, len));
+	}
+	INL bool startsWith(const MyType &prefix) const {
+		return(s_ && prefix.s_ && StringAlgo::startsWith(s_, length(), prefix.s_, prefix.length()));
+	}
+	INL bool endsWith(const MyType &suffix) const {
+		return(s_ && suffix.s_ && StringAlgo::endsWith(s_, length(), suffix.s_, suffix.length()));
+	}
+	INL int indexOf(int ch, int fromIndex = 0) const {
+		return(s_ ? StringAlgo::indexOf(s_, length(), ch, fromIndex) : -1);
+	}
+	INL int indexOf(const MyType &sub, int fromIndex = 0) const {
+		return((s_ && sub.s_) ? StringAlgo::indexOf(s_, length(), sub.s_, sub.length(), fromIndex) : -1);
+	}
+	INL int lastIndexOf(int ch) const {
+		return(s_ ? StringAlgo::lastIndexOf(s_, length(), ch) : -1);
+	}
+	INL int lastIndexOf(const MyType &sub) const {
+		return((s_ && sub.s_) ? StringAlgo::lastIndexOf(s_, length(), sub.s_, sub.length()) : -1);
 	}
 
 	INL bool operator ==(const MyType &b) const { return(s_ == b.s_); }
@@ -143,8 +180,8 @@ public:
 
 	INL operator const bool() const { return(s_ != nullptr); }
 
-    INL operator std::basic_string_view<CharT> () {
-        return(std::basic_string_view<CharT>(c_str(),length()));
+    INL operator std::basic_string_view<CharT> () const {
+        return(view());
     }
 
     
@@ -173,7 +210,7 @@ ARTD_END
 
 
 ARTD_ALWAYS_INLINE std::ostream& operator<<(std::ostream& os, const artd::StringArg& v) {
-	os << v.c_str();
+	os << v.view();
 	return(os);
 }
 
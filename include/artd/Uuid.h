@@ -74,6 +74,8 @@ private:
 	/** @brief compiler often moves each field individually and this is faster */
 	INL void assign(const void *src) { class mem { protected: uint32_t d[4]; }; *((mem *)this) = *((mem *)src); }
 public:
+	INL Uuid() = default;
+	INL Uuid(const Uuid &src) = default;
 	/** @brief assignment operator */
 	INL Uuid &operator =(const Uuid &src) { assign(&src); return(*this); }
 
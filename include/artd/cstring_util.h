@@ -56,6 +56,15 @@ ARTD_API_JLIB_BASE int ul64tostr(uint64_t num,char *out,int radix);
 ARTD_API_JLIB_BASE int sizettostr(size_t num,wchar_t *out,int radix);
 ARTD_API_JLIB_BASE int sizettostr(size_t num,char *out,int radix);
 
+/** longest text dtostr() or ftostr() will write, not counting the null */
+static const int MaxRealTextLength = 32;
+
+/** shortest text that reads back as the same value, ie: 0.1 not 0.10000000000000001
+ * out must have room for MaxRealTextLength + 1 chars.
+ */
+ARTD_API_JLIB_BASE int dtostr(double num, char *out);
+ARTD_API_JLIB_BASE int ftostr(float num, char *out);
+
 inline int strtoi(const char *in) { return(::atoi(in));}
 ARTD_API_JLIB_BASE int strtoi(const wchar_t *str);
 
@@ -186,6 +186,27 @@ public:
         return((char *)decode(out, (const unsigned char *)psrc, size));
     }
 
+	// Strict, locale independent conversions between counted wchar_t and utf8
+	// buffers. wchar_t is treated as UTF-32 or as UTF-16 where it is 16 bits.
+	// Invalid input (unpaired surrogates, out of range or malformed sequences)
+	// is converted to U+FFFD. ASCII runs are converted a block at a time.
+
+	/** @brief exact count of utf8 bytes encodeTo() will write for len wchar_t, not including a null */
+	static int encodedSize(const wchar_t *src, int len);
+	/**
+	 * @brief encodes len wchar_t into out which must have room for encodedSize(src,len) bytes
+	 * @return pointer one beyond the last byte written, does not null terminate
+	 */
+	static char *encodeTo(char *out, const wchar_t *src, int len);
+
+	/** @brief exact count of wchar_t decodeTo() will write for len utf8 bytes, not including a null */
+	static int decodedLength(const char *src, int len);
+	/**
+	 * @brief decodes len utf8 bytes into out which must have room for decodedLength(src,len) wchar_t
+	 * @return pointer one beyond the last wchar_t written, does not null terminate
+	 */
+	static wchar_t *decodeTo(wchar_t *out, const char *src, int len);
+
 	// the below were used to encode integers to send to Flash
 	// to use their XML socket for binary values.
 	static char *addUint7(char *buf,unsigned int val)
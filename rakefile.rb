@@ -16,12 +16,20 @@ Rakish::CppProject.new(
 
     addSourceFiles(
         'ArtdClassId.cpp',
+        'BinaryArchive.cpp',
+        'ByteArrayPool.cpp',
+        'FormatPlan.cpp',
         'Formatf.cpp',
+        'FormatfSink.cpp',
         'HexFormatter.cpp',
         'IntrusiveList.cpp',
+        'MappedFile.cpp',
         'ObjectBase.cpp',
         'RcArray.cpp',
         'RcString.cpp',
+        'RcStringBatch.cpp',
+        'RcStringStats.cpp',
+        'StringAlgo.cpp',
         'base_types.cpp',
         'cstring_util.cpp',
         'Uuid.cpp',
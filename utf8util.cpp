@@ -1,4 +1,11 @@
 #include "artd/utf8util.h"
+#include "artd/int_types.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ARTD_UTF8_SSE2 1
+	#include <emmintrin.h>
+#endif
 
 ARTD_BEGIN
 
@@ -133,4 +140,281 @@ done:
 }
 
 
+// ********* strict counted conversions
+
+namespace {
+
+const unsigned int ReplacementChar = 0xFFFD;
+const bool WcharIsUtf16 = (sizeof(wchar_t) == 2);
+
+// utf8 size of a single code point, invalid ones are replaced by U+FFFD which is 3 bytes
+ARTD_ALWAYS_INLINE int utf8SizeOf(uint32_t c)
+{
+	return(1 + (c > 0x7F) + (c > 0x7FF) + (c > 0xFFFF && c <= 0x10FFFF));
+}
+
+ARTD_ALWAYS_INLINE char *putUtf8(char *out, uint32_t c)
+{
+	if(c < 0x80) {
+		*out++ = (char)c;
+	} else if(c < 0x800) {
+		*out++ = (char)(0xC0 | (c >> 6));
+		*out++ = (char)(0x80 | (c & 0x3F));
+	} else if(c < 0x10000) {
+		if(c - 0xD800u < 0x800u) {
+			c = ReplacementChar;
+		}
+		*out++ = (char)(0xE0 | (c >> 12));
+		*out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (c & 0x3F));
+	} else if(c <= 0x10FFFF) {
+		*out++ = (char)(0xF0 | (c >> 18));
+		*out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+		*out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (c & 0x3F));
+	} else {
+		*out++ = (char)0xEF;
+		*out++ = (char)0xBF;
+		*out++ = (char)0xBD;
+	}
+	return(out);
+}
+
+// Fetches the next code point from a wchar_t buffer pairing utf16 surrogates
+// when wchar_t is 16 bits. Unpaired surrogates come back as U+FFFD.
+ARTD_ALWAYS_INLINE uint32_t nextWide(const wchar_t *&p, const wchar_t *max)
+{
+	uint32_t c = (uint32_t)*p++;
+	if(WcharIsUtf16) {
+		c &= 0xFFFF;
+		if(c - 0xD800u < 0x800u) {
+			if(c < 0xDC00 && p < max) {
+				const uint32_t lo = (uint32_t)(*p) & 0xFFFF;
+				if(lo - 0xDC00u < 0x400u) {
+					++p;
+					return(0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00));
+				}
+			}
+			return(ReplacementChar);
+		}
+	}
+	return(c);
+}
+
+ARTD_ALWAYS_INLINE wchar_t *putWide(wchar_t *out, uint32_t c)
+{
+	if(WcharIsUtf16 && c >= 0x10000) {
+		c -= 0x10000;
+		*out++ = (wchar_t)(0xD800 + (c >> 10));
+		*out++ = (wchar_t)(0xDC00 + (c & 0x3FF));
+		return(out);
+	}
+	*out++ = (wchar_t)c;
+	return(out);
+}
+
+// Decodes one non ASCII utf8 sequence starting at p (which is < max).
+// Malformed, overlong, surrogate and out of range sequences give U+FFFD
+// and consume one byte.
+ARTD_ALWAYS_INLINE uint32_t nextUtf8(const unsigned char *&p, const unsigned char *max)
+{
+	const uint32_t lead = *p;
+	int need;
+	uint32_t c;
+	uint32_t minValue;
+
+	if(lead - 0xC2u < (0xE0u - 0xC2u)) {
+		need = 1; c = lead & 0x1F; minValue = 0x80;
+	} else if((lead & 0xF0) == 0xE0) {
+		need = 2; c = lead & 0x0F; minValue = 0x800;
+	} else if(lead - 0xF0u < 5u) {
+		need = 3; c = lead & 0x07; minValue = 0x10000;
+	} else {
+		goto bad;
+	}
+	if(max - p <= need) {
+		goto bad;
+	}
+	for(int i = 1; i <= need; ++i) {
+		const uint32_t cc = p[i];
+		if((cc & 0xC0) != 0x80) {
+			goto bad;
+		}
+		c = (c << 6) | (cc & 0x3F);
+	}
+	if(c < minValue || c > 0x10FFFF || (c - 0xD800u < 0x800u)) {
+		goto bad;
+	}
+	p += need + 1;
+	return(c);
+bad:
+	++p;
+	return(ReplacementChar);
+}
+
+#ifdef ARTD_UTF8_SSE2
+// true if all 8 values in a and b are < 0x80
+ARTD_ALWAYS_INLINE bool isAscii32x8(__m128i a, __m128i b)
+{
+	const __m128i hi = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi32(~0x7F));
+	return(_mm_movemask_epi8(_mm_cmpeq_epi32(hi, _mm_setzero_si128())) == 0xFFFF);
+}
+#endif
+
+} // anonymous
+
+int
+Utf8::encodedSize(const wchar_t *src, int len)
+{
+	const wchar_t *p = src;
+	const wchar_t *max = src + len;
+	int size = 0;
+
+	if(WcharIsUtf16) {
+		while(p < max) {
+			size += utf8SizeOf(nextWide(p, max));
+		}
+		return(size);
+	}
+
+#ifdef ARTD_UTF8_SSE2
+	// 1 byte each plus one for each threshold passed, unsigned compares are done
+	// signed by flipping the sign bit. Lane counts are reduced every block so they
+	// can't overflow.
+	{
+		const __m128i sign = _mm_set1_epi32((int)0x80000000);
+		const __m128i gt7F = _mm_set1_epi32((int)(0x7F ^ 0x80000000));
+		const __m128i gt7FF = _mm_set1_epi32((int)(0x7FF ^ 0x80000000));
+		const __m128i gtFFFF = _mm_set1_epi32((int)(0xFFFF ^ 0x80000000));
+		const __m128i gt10FFFF = _mm_set1_epi32((int)(0x10FFFF ^ 0x80000000));
+
+		while(max - p >= 4) {
+			const __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), sign);
+			__m128i extra = _mm_cmpgt_epi32(v, gt7F);
+			extra = _mm_add_epi32(extra, _mm_cmpgt_epi32(v, gt7FF));
+			extra = _mm_add_epi32(extra, _mm_andnot_si128(_mm_cmpgt_epi32(v, gt10FFFF), _mm_cmpgt_epi32(v, gtFFFF)));
+			extra = _mm_add_epi32(extra, _mm_shuffle_epi32(extra, _MM_SHUFFLE(1, 0, 3, 2)));
+			extra = _mm_add_epi32(extra, _mm_shuffle_epi32(extra, _MM_SHUFFLE(2, 3, 0, 1)));
+			size += 4 - _mm_cvtsi128_si32(extra); // masks are -1
+			p += 4;
+		}
+	}
+#endif
+	while(p < max) {
+		size += utf8SizeOf((uint32_t)*p++);
+	}
+	return(size);
+}
+
+char *
+Utf8::encodeTo(char *out, const wchar_t *src, int len)
+{
+	const wchar_t *p = src;
+	const wchar_t *max = src + len;
+
+	while(p < max) {
+#ifdef ARTD_UTF8_SSE2
+		if(!WcharIsUtf16) {
+			// narrow runs of 8 ASCII chars at a time
+			while(max - p >= 8) {
+				const __m128i a = _mm_loadu_si128((const __m128i *)p);
+				const __m128i b = _mm_loadu_si128((const __m128i *)(p + 4));
+				if(!isAscii32x8(a, b)) {
+					break;
+				}
+				const __m128i w16 = _mm_packs_epi32(a, b);
+				_mm_storel_epi64((__m128i *)out, _mm_packus_epi16(w16, w16));
+				out += 8;
+				p += 8;
+			}
+			if(p >= max) {
+				break;
+			}
+		}
+#endif
+		const uint32_t c = nextWide(p, max);
+		if(c < 0x80) {
+			*out++ = (char)c;
+			continue;
+		}
+		out = putUtf8(out, c);
+	}
+	return(out);
+}
+
+int
+Utf8::decodedLength(const char *src, int len)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const unsigned char *max = p + len;
+	int count = 0;
+
+	while(p < max) {
+		// whole blocks of ASCII
+		while(max - p >= 8) {
+			uint64_t block;
+			::memcpy(&block, p, sizeof(block));
+			if(block & 0x8080808080808080ull) {
+				break;
+			}
+			count += 8;
+			p += 8;
+		}
+		if(p >= max) {
+			break;
+		}
+		if(*p < 0x80) {
+			++p;
+			++count;
+			continue;
+		}
+		const uint32_t c = nextUtf8(p, max);
+		count += (WcharIsUtf16 && c >= 0x10000) ? 2 : 1;
+	}
+	return(count);
+}
+
+wchar_t *
+Utf8::decodeTo(wchar_t *out, const char *src, int len)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const unsigned char *max = p + len;
+
+	while(p < max) {
+#ifdef ARTD_UTF8_SSE2
+		// widen runs of 16 ASCII bytes at a time
+		while(max - p >= 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i *)p);
+			if(_mm_movemask_epi8(v) != 0) {
+				break;
+			}
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i lo16 = _mm_unpacklo_epi8(v, zero);
+			const __m128i hi16 = _mm_unpackhi_epi8(v, zero);
+			if(WcharIsUtf16) {
+				_mm_storeu_si128((__m128i *)out, lo16);
+				_mm_storeu_si128((__m128i *)(out + 8), hi16);
+			} else {
+				_mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(lo16, zero));
+				_mm_storeu_si128((__m128i *)(out + 4), _mm_unpackhi_epi16(lo16, zero));
+				_mm_storeu_si128((__m128i *)(out + 8), _mm_unpacklo_epi16(hi16, zero));
+				_mm_storeu_si128((__m128i *)(out + 12), _mm_unpackhi_epi16(hi16, zero));
+			}
+			out += 16;
+			p += 16;
+		}
+		if(p >= max) {
+			break;
+		}
+#endif
+		if(*p < 0x80) {
+			*out++ = (wchar_t)*p++;
+			continue;
+		}
+		out = putWide(out, nextUtf8(p, max));
+	}
+	return(out);
+}
+
+
 ARTD_END